@@ -0,0 +1,701 @@
+/*
+ * Ultimate Word Search Generator
+ * Copyright (C) 2024  Alexandra Dogwood
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: hello@adogwood.com
+ */
+
+// Benchmarks for the Ultimate Word Search Generator. Build and run from the
+// repository root:
+//   g++ -std=c++11 -O2 -pthread tests/bench_ultimateWordSearchGenerator.cpp -o bench_wordsearch
+//   ./bench_wordsearch threads [MAX_THREADS]
+//   ./bench_wordsearch sweep [CSV_FILE] [BUDGET_SECONDS]
+//   ./bench_wordsearch fill
+//   ./bench_wordsearch compare [BASELINE_JSON] [--write-baseline] [--allow-new] [--repetitions N]
+
+#define WORDSEARCH_NO_MAIN
+#include "../ultimateWordSearchGenerator.cpp"
+
+#include <cctype>
+#include <cmath>
+#include <functional>
+
+const char* benchOutputFile = "bench_puzzles.txt";
+
+// A fixed-seed job, so every run and every thread count does the same work
+PuzzleJob benchJob(int numPuzzles, int numThreads) {
+    PuzzleJob job;
+    job.numPuzzles = numPuzzles;
+    job.rows = 25;
+    job.cols = 25;
+    job.words = { "ABBA", "CAD", "DAD", "BCDA", "ACDC" };
+    job.letters = { 'A', 'B', 'C', 'D' };
+    job.bannedWords = { "ABCD", "DCBA", "BADC" };
+    job.outputFile = benchOutputFile;
+    job.seed = 12345;
+    job.numThreads = numThreads;
+    return job;
+}
+
+// Run the same job at 1, 2, 4, ... workers and report speedup over one
+// worker, parallel efficiency, and how long workers waited on the output lock
+void benchThreadScaling(int maxThreads) {
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    const int numPuzzles = 16 * maxThreads;
+    std::printf("Thread scaling: %d puzzles of 25x25, seed %u\n", numPuzzles, benchJob(0, 0).seed);
+    std::printf("%8s %10s %8s %11s %14s %7s\n", "threads", "seconds", "speedup", "efficiency", "output wait s", "wait %");
+
+    double baseline = 0;
+    for (int threads : threadCounts) {
+        JobStats stats = generatePuzzles(benchJob(numPuzzles, threads));
+        if (threads == 1) {
+            baseline = stats.elapsedSeconds;
+        }
+        double speedup = baseline / stats.elapsedSeconds;
+        double waitPercent = 100.0 * stats.outputWaitSeconds / (stats.elapsedSeconds * stats.numThreads);
+        std::printf("%8d %10.3f %8.2f %10.1f%% %14.4f %6.2f%%\n", stats.numThreads, stats.elapsedSeconds, speedup,
+                    100.0 * speedup / stats.numThreads, stats.outputWaitSeconds, waitPercent);
+    }
+    std::remove(benchOutputFile);
+}
+
+// Fill one large grid in blocks on 1, 2, 4, ... maxThreads threads. The
+// grids must come out the same; the speedup is over the one-thread block fill.
+void benchParallelFill(int maxThreads) {
+    const int side = 800;
+    const std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    const std::unordered_set<std::string> banned = { "ABCA", "CBAB", "BACC", "DADA" };
+    std::printf("Parallel fill: one %dx%d grid\n", side, side);
+    std::printf("%8s %10s %8s %11s %10s\n", "threads", "seconds", "speedup", "efficiency", "same grid");
+
+    double baseline = 0;
+    std::string firstGrid;
+    for (int threads = 1;; threads = std::min(2 * threads, maxThreads)) {
+        WordSearch ws(side, side, std::vector<std::string>(), letters, banned, 2024);
+        ws.setFillThreads(threads);
+        auto start = std::chrono::steady_clock::now();
+        ws.fillGrid();
+        double seconds = microsSince(start) / 1e6;
+        std::ostringstream grid;
+        ws.printGrid(grid);
+        if (threads == 1) {
+            baseline = seconds;
+            firstGrid = grid.str();
+        }
+        std::printf("%8d %10.3f %8.2f %10.1f%% %10s\n", threads, seconds, baseline / seconds, 100.0 * baseline / seconds / threads,
+                    grid.str() == firstGrid ? "yes" : "NO");
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+}
+
+// One measurement of a sweep: filling a grid where the swept parameter was x
+struct SweepPoint {
+    double x;
+    double fillSeconds;
+    std::uint64_t bannedChecks;
+
+    double secondsPerCheck() const { return bannedChecks ? fillSeconds / bannedChecks : 0; }
+};
+
+// `count` distinct random words of the given length over `alphabet`
+std::unordered_set<std::string> randomWords(int count, int length, const std::string& alphabet, std::mt19937& rng) {
+    std::uniform_int_distribution<int> letterDist(0, alphabet.size() - 1);
+    std::unordered_set<std::string> result;
+    while (static_cast<int>(result.size()) < count) {
+        std::string word(length, ' ');
+        for (auto& letter : word) {
+            letter = alphabet[letterDist(rng)];
+        }
+        result.insert(word);
+    }
+    return result;
+}
+
+// Fill one empty grid with a fixed seed and time it
+SweepPoint timeFill(double x, int rows, int cols, const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords) {
+    WordSearch ws(rows, cols, std::vector<std::string>(), letters, bannedWords, 2024);
+    auto start = std::chrono::steady_clock::now();
+    ws.fillGrid();
+    SweepPoint point;
+    point.x = x;
+    point.fillSeconds = microsSince(start) / 1e6;
+    point.bannedChecks = ws.stats().bannedChecks;
+    return point;
+}
+
+// Least-squares slope of log(y) against log(x): the exponent k in y ~ x^k
+double fitExponent(const std::vector<SweepPoint>& points, bool perCheck) {
+    double n = 0, sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (const auto& point : points) {
+        double y = perCheck ? point.secondsPerCheck() : point.fillSeconds;
+        if (y <= 0) {
+            continue;
+        }
+        double lx = std::log(point.x), ly = std::log(y);
+        n += 1;
+        sumX += lx;
+        sumY += ly;
+        sumXX += lx * lx;
+        sumXY += lx * ly;
+    }
+    double denominator = n * sumXX - sumX * sumX;
+    return (n < 2 || denominator == 0) ? 0 : (n * sumXY - sumX * sumY) / denominator;
+}
+
+// Measure one sweep from the smallest parameter upwards. Once a point takes
+// longer than the budget the larger ones are skipped, since the current fill
+// grows too fast to reach them.
+void runSweep(const std::string& name, const std::string& parameter, const std::vector<double>& values,
+              const std::function<SweepPoint(double)>& measure, double budgetSeconds, std::ostream& csv) {
+    std::printf("%s (x = %s)\n", name.c_str(), parameter.c_str());
+    std::vector<SweepPoint> points;
+    for (double value : values) {
+        SweepPoint point = measure(value);
+        points.push_back(point);
+        csv << name << "," << parameter << "," << point.x << "," << point.fillSeconds << ","
+            << point.bannedChecks << "," << point.secondsPerCheck() << std::endl;
+        std::printf("  x=%-8g fill=%10.6fs checks=%-8llu per check=%.3gs\n", point.x, point.fillSeconds,
+                    static_cast<unsigned long long>(point.bannedChecks), point.secondsPerCheck());
+        std::fflush(stdout);
+        if (point.fillSeconds > budgetSeconds) {
+            std::printf("  larger x skipped: over the %.1fs budget\n", budgetSeconds);
+            break;
+        }
+    }
+    std::printf("  fill time ~ x^%.2f, banned check time ~ x^%.2f\n", fitExponent(points, false), fitExponent(points, true));
+}
+
+// Sweep grid edge, banned list size and banned word length, fit how fill and
+// banned checking time grow with each, and write every point to CSV
+void benchComplexitySweep(const std::string& csvFile, double budgetSeconds) {
+    std::ofstream csv(csvFile);
+    if (!csv.is_open()) {
+        std::cerr << "Error: cannot write " << csvFile << "\n";
+        return;
+    }
+    csv << "series,parameter,x,fill_seconds,banned_checks,seconds_per_check\n";
+
+    // Banned words never use the last fill letter, so every cell always has a valid letter
+    const std::vector<char> fourLetters = { 'A', 'B', 'C', 'D' };
+    const std::vector<char> eightLetters = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H' };
+    std::mt19937 rng(7);
+
+    std::vector<double> edges;
+    for (double edge = 10; edge < 2000; edge *= std::sqrt(2.0)) {
+        edges.push_back(std::floor(edge));
+    }
+    edges.push_back(2000);
+    std::unordered_set<std::string> fixedBanned = { "ABCA", "CBAB", "BACC" };
+    runSweep("grid_edge", "cells", edges, [&](double edge) {
+        SweepPoint point = timeFill(edge, static_cast<int>(edge), static_cast<int>(edge), fourLetters, fixedBanned);
+        point.x = edge * edge;
+        return point;
+    }, budgetSeconds, csv);
+
+    // Length-8 words over seven letters keep even 100k banned words rare enough to fill around
+    std::vector<double> bannedCounts = { 1, 3, 10, 30, 100, 300, 1000, 3000, 10000, 30000, 100000 };
+    runSweep("banned_count", "banned words", bannedCounts, [&](double count) {
+        return timeFill(count, 12, 12, eightLetters, randomWords(static_cast<int>(count), 8, "ABCDEFG", rng));
+    }, budgetSeconds, csv);
+
+    std::vector<double> lengths;
+    for (int length = 3; length <= 15; ++length) {
+        lengths.push_back(length);
+    }
+    runSweep("banned_length", "banned word length", lengths, [&](double length) {
+        return timeFill(length, 20, 20, fourLetters, randomWords(4, static_cast<int>(length), "ABC", rng));
+    }, budgetSeconds, csv);
+
+    std::printf("Wrote %s\n", csvFile.c_str());
+}
+
+// Timing of one benchmark over several repetitions
+struct BenchResult {
+    double mean = 0;
+    double stddev = 0;
+    int n = 0;
+};
+
+BenchResult summarize(const std::vector<double>& samples) {
+    BenchResult result;
+    result.n = static_cast<int>(samples.size());
+    for (double sample : samples) {
+        result.mean += sample;
+    }
+    result.mean /= std::max(1, result.n);
+    for (double sample : samples) {
+        result.stddev += (sample - result.mean) * (sample - result.mean);
+    }
+    result.stddev = result.n > 1 ? std::sqrt(result.stddev / (result.n - 1)) : 0;
+    return result;
+}
+
+// The benchmarks guarded by the regression gate, each one fixed-seed
+struct SuiteBenchmark {
+    const char* name;
+    std::function<void()> run;
+};
+
+std::vector<SuiteBenchmark> regressionSuite() {
+    static const std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    static const std::vector<std::string> words = { "ABBA", "CAD", "DAD", "BCDA", "ACDC", "CAB", "DABBA", "BAD" };
+    static const std::unordered_set<std::string> banned = { "ABCA", "CBAB", "BACC" };
+    // More letters than a 30 by 60 grid has cells, so many words only fit
+    // across others and fall back to checking every slot. Rows of 60 cells
+    // fit one bitboard word.
+    static const std::vector<std::string> denseWords = [] {
+        std::mt19937 rng(8);
+        std::unordered_set<std::string> unique = randomWords(400, 6, "ABCD", rng);
+        std::vector<std::string> sorted(unique.begin(), unique.end());
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    }();
+    return {
+        { "fill_25x25", [] {
+            WordSearch ws(25, 25, std::vector<std::string>(), letters, banned, 1);
+            ws.fillGrid();
+        } },
+        { "placement_30x25", [] {
+            // One placement takes microseconds; time a hundred, each from its own seed
+            for (unsigned seed = 2; seed < 102; ++seed) {
+                WordSearch ws(30, 25, words, letters, banned, seed);
+                ws.placeWords();
+            }
+        } },
+        { "placement_30x60", [] {
+            for (unsigned seed = 2; seed < 12; ++seed) {
+                WordSearch ws(30, 60, denseWords, letters, banned, seed);
+                ws.placeWords();
+            }
+        } },
+        { "placement_30x60_wrapped", [] {
+            for (unsigned seed = 2; seed < 12; ++seed) {
+                WordSearch ws(30, 60, denseWords, letters, banned, seed);
+                ws.setWrapAround(true);
+                ws.placeWords();
+            }
+        } },
+        { "generate_20x20", [] {
+            WordSearch ws(20, 20, words, letters, banned, 3);
+            ws.generate();
+        } },
+        { "generate_20x20_wrapped", [] {
+            WordSearch ws(20, 20, words, letters, banned, 3);
+            ws.setWrapAround(true);
+            ws.generate();
+        } },
+        { "fill_25x25_repair", [] {
+            WordSearch ws(25, 25, std::vector<std::string>(), letters, banned, 1);
+            ws.setFillMode(FillMode::Repair);
+            ws.fillGrid();
+        } },
+        { "fill_25x25_tiles", [] {
+            static const auto tiles = TileLibrary::load("", letters, banned, BannedWordMatcher(banned));
+            WordSearch ws(25, 25, std::vector<std::string>(), letters, banned, 1);
+            ws.setFillMode(FillMode::Tiles, tiles);
+            ws.fillGrid();
+        } },
+        { "fill_300x300", [] {
+            WordSearch ws(300, 300, std::vector<std::string>(), letters, banned, 6);
+            ws.fillGrid();
+        } },
+        { "fill_300x300_shadowed", [] {
+            WordSearch ws(300, 300, std::vector<std::string>(), letters, banned, 6);
+            ws.setShadowGrids(true);
+            ws.fillGrid();
+        } },
+        { "fill_300x300_wrapped", [] {
+            WordSearch ws(300, 300, std::vector<std::string>(), letters, banned, 6);
+            ws.setWrapAround(true);
+            ws.fillGrid();
+        } },
+        { "fill_100x100_no_banned", [] {
+            WordSearch ws(100, 100, std::vector<std::string>(), letters, std::unordered_set<std::string>(), 6);
+            ws.fillGrid();
+        } },
+        { "variant_30x25", [] {
+            static const WordSearch placed = [] {
+                WordSearch ws(30, 25, words, letters, banned, 2);
+                ws.placeWords();
+                return ws;
+            }();
+            WordSearch variant = placed.variant(7);
+            variant.fillGrid();
+        } },
+        { "fill_12x12_300_banned", [] {
+            std::mt19937 rng(4);
+            static const std::unordered_set<std::string> manyBanned = randomWords(300, 8, "ABCDEFG", rng);
+            static const std::vector<char> eightLetters = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H' };
+            WordSearch ws(12, 12, std::vector<std::string>(), eightLetters, manyBanned, 5);
+            ws.fillGrid();
+        } },
+        { "job_16_puzzles", [] {
+            generatePuzzles(benchJob(16, 1));
+        } },
+    };
+}
+
+// One fill-mode comparison: a grid, an alphabet and a banned list
+struct FillScenario {
+    const char* name;
+    int rows;
+    int cols;
+    std::string alphabet;
+    int bannedCount;
+    int bannedLength;
+};
+
+// Fill the same empty grids by rejection, by repair, with tiles and
+// balanced, reporting time, banned-word checks, repair steps, unfilled cells
+// and the spread between the most and least used letters. The
+// tile library is built once per scenario, as a job would, and timed apart.
+void benchFillModes() {
+    const FillScenario scenarios[] = {
+        { "4 letters, 3 banned of 4", 25, 25, "ABCD", 3, 4 },
+        { "4 letters, 40 banned of 3", 25, 25, "ABCD", 40, 3 },
+        { "3 letters, 12 banned of 3", 25, 25, "ABC", 12, 3 },
+        { "3 letters, 12 banned of 3", 80, 80, "ABC", 12, 3 },
+        { "2 letters, 6 banned of 4", 40, 40, "AB", 6, 4 },
+        { "8 letters, 300 banned of 8", 25, 25, "ABCDEFGH", 300, 8 },
+    };
+    const int seeds = 5;
+    std::printf("Fill modes: mean of %d seeds per scenario\n", seeds);
+    std::printf("%-28s %7s %-9s %10s %12s %12s %9s %7s\n", "scenario", "grid", "mode", "ms", "checks", "repairs", "unfilled", "spread");
+    for (const auto& scenario : scenarios) {
+        std::mt19937 rng(91);
+        auto banned = randomWords(scenario.bannedCount, scenario.bannedLength, scenario.alphabet, rng);
+        std::vector<char> letters(scenario.alphabet.begin(), scenario.alphabet.end());
+        std::string grid = std::to_string(scenario.rows) + "x" + std::to_string(scenario.cols);
+        auto buildStart = std::chrono::steady_clock::now();
+        auto tiles = TileLibrary::load("", letters, banned, BannedWordMatcher(banned));
+        double buildMilliseconds = microsSince(buildStart) / 1e3;
+        for (FillMode mode : { FillMode::Rejection, FillMode::Repair, FillMode::Tiles, FillMode::Balanced }) {
+            double seconds = 0;
+            double checks = 0;
+            double repairs = 0;
+            double unfilled = 0;
+            double spread = 0;
+            for (int seed = 0; seed < seeds; ++seed) {
+                WordSearch ws(scenario.rows, scenario.cols, std::vector<std::string>(), letters, banned, 2024 + seed);
+                ws.setFillMode(mode, tiles);
+                auto start = std::chrono::steady_clock::now();
+                ws.fillGrid();
+                seconds += microsSince(start) / 1e6;
+                checks += ws.stats().bannedChecks;
+                repairs += ws.stats().repairSteps;
+                unfilled += ws.stats().unfilledCells;
+                std::map<char, int> counts;
+                for (int r = 0; r < scenario.rows; ++r) {
+                    for (int c = 0; c < scenario.cols; ++c) {
+                        ++counts[ws.cell(r, c)];
+                    }
+                }
+                int most = 0, fewest = scenario.rows * scenario.cols;
+                for (char letter : letters) {
+                    most = std::max(most, counts[letter]);
+                    fewest = std::min(fewest, counts[letter]);
+                }
+                spread += most - fewest;
+            }
+            const char* modeName = mode == FillMode::Repair ? "repair" : mode == FillMode::Tiles ? "tiles"
+                                 : mode == FillMode::Balanced ? "balanced" : "rejection";
+            std::printf("%-28s %7s %-9s %10.3f %12.0f %12.0f %9.1f %7.1f\n", scenario.name, grid.c_str(), modeName,
+                        1e3 * seconds / seeds, checks / seeds, repairs / seeds, unfilled / seeds, spread / seeds);
+        }
+        std::printf("%-28s %7s %-9s (library of %d tiles built in %.1f ms)\n", "", "", "", tiles->count(), buildMilliseconds);
+    }
+}
+
+// Two-sided critical value of Student's t for the given confidence and
+// degrees of freedom (Cornish-Fisher expansion around the normal quantile)
+double tCritical(double confidence, double degreesOfFreedom) {
+    double z = confidence >= 0.99 ? 2.5758 : confidence >= 0.95 ? 1.9600 : 1.6449;
+    double df = std::max(1.0, degreesOfFreedom);
+    double z3 = z * z * z, z5 = z3 * z * z;
+    return z + (z3 + z) / (4 * df) + (5 * z5 + 16 * z3 + 3 * z) / (96 * df * df);
+}
+
+// Minimal reader for the baseline file written by writeBaseline:
+// {"repetitions": N, "benchmarks": {"name": {"mean": x, "stddev": y, "n": k}, ...}}
+class BaselineReader {
+public:
+    explicit BaselineReader(const std::string& text) : text(text) {}
+
+    bool read(std::map<std::string, BenchResult>& results) {
+        if (!expect('{')) {
+            return false;
+        }
+        while (true) {
+            std::string key;
+            if (!readString(key) || !expect(':')) {
+                return false;
+            }
+            if (key == "benchmarks") {
+                if (!readBenchmarks(results)) {
+                    return false;
+                }
+            } else {
+                double ignored;
+                if (!readNumber(ignored)) {
+                    return false;
+                }
+            }
+            if (!expect(',')) {
+                return expect('}');
+            }
+        }
+    }
+
+private:
+    const std::string& text;
+    std::size_t pos = 0;
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+    }
+
+    bool expect(char c) {
+        skipSpace();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool readString(std::string& out) {
+        if (!expect('"')) {
+            return false;
+        }
+        std::size_t end = text.find('"', pos);
+        if (end == std::string::npos) {
+            return false;
+        }
+        out = text.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    }
+
+    bool readNumber(double& out) {
+        skipSpace();
+        const char* start = text.c_str() + pos;
+        char* end;
+        out = std::strtod(start, &end);
+        if (end == start) {
+            return false;
+        }
+        pos += end - start;
+        return true;
+    }
+
+    bool readBenchmarks(std::map<std::string, BenchResult>& results) {
+        if (!expect('{')) {
+            return false;
+        }
+        if (expect('}')) {
+            return true;
+        }
+        do {
+            std::string name;
+            if (!readString(name) || !expect(':') || !expect('{')) {
+                return false;
+            }
+            BenchResult result;
+            do {
+                std::string field;
+                double value;
+                if (!readString(field) || !expect(':') || !readNumber(value)) {
+                    return false;
+                }
+                if (field == "mean") {
+                    result.mean = value;
+                } else if (field == "stddev") {
+                    result.stddev = value;
+                } else if (field == "n") {
+                    result.n = static_cast<int>(value);
+                }
+            } while (expect(','));
+            if (!expect('}')) {
+                return false;
+            }
+            results[name] = result;
+        } while (expect(','));
+        return expect('}');
+    }
+};
+
+void writeBaseline(const std::string& path, int repetitions, const std::map<std::string, BenchResult>& results) {
+    std::ofstream file(path);
+    file << "{\n  \"repetitions\": " << repetitions << ",\n  \"benchmarks\": {\n";
+    std::size_t i = 0;
+    for (const auto& entry : results) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "    \"%s\": {\"mean\": %.9g, \"stddev\": %.9g, \"n\": %d}%s\n",
+                      entry.first.c_str(), entry.second.mean, entry.second.stddev, entry.second.n,
+                      ++i < results.size() ? "," : "");
+        file << line;
+    }
+    file << "  }\n}\n";
+}
+
+// Run the regression suite and compare each benchmark with the baseline
+// using Welch's t-test. A benchmark regresses when it is slower at 99%
+// confidence and by more than minSlowdown. A benchmark missing from the
+// baseline fails the comparison too, since it is not gated at all, unless
+// allowNew is set. Returns the process exit code: 0 when nothing regressed,
+// 1 on a regression or a missing benchmark, 2 when the baseline is unusable.
+int benchCompare(const std::string& baselineFile, bool writeNewBaseline, int repetitions, bool allowNew) {
+    const double confidence = 0.99;
+    const double minSlowdown = 0.05;
+
+    std::map<std::string, BenchResult> current;
+    for (const auto& benchmark : regressionSuite()) {
+        benchmark.run(); // Warm up caches and function-local statics
+        std::vector<double> samples;
+        for (int i = 0; i < repetitions; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            benchmark.run();
+            samples.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        current[benchmark.name] = summarize(samples);
+    }
+    std::remove(benchOutputFile);
+
+    if (writeNewBaseline) {
+        writeBaseline(baselineFile, repetitions, current);
+        std::printf("Wrote baseline %s\n", baselineFile.c_str());
+        return 0;
+    }
+
+    std::ifstream file(baselineFile);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string text = contents.str();
+    std::map<std::string, BenchResult> baseline;
+    if (!file.is_open() || !BaselineReader(text).read(baseline)) {
+        std::cerr << "Error: cannot read baseline " << baselineFile << "\n";
+        return 2;
+    }
+
+    int regressions = 0;
+    int missing = 0;
+    std::printf("%-24s %12s %12s %8s %26s  %s\n", "benchmark", "baseline s", "current s", "change", "99% CI of change", "verdict");
+    for (const auto& entry : current) {
+        const BenchResult& now = entry.second;
+        auto found = baseline.find(entry.first);
+        if (found == baseline.end()) {
+            std::printf("%-24s %12s %12.6f %8s %26s  %s\n", entry.first.c_str(), "-", now.mean, "-", "-", allowNew ? "new" : "NOT IN BASELINE");
+            missing += !allowNew;
+            continue;
+        }
+        const BenchResult& before = found->second;
+        double varianceNow = now.stddev * now.stddev / now.n;
+        double varianceBefore = before.stddev * before.stddev / std::max(1, before.n);
+        double standardError = std::sqrt(varianceNow + varianceBefore);
+        double degreesOfFreedom = standardError > 0
+            ? std::pow(varianceNow + varianceBefore, 2) /
+                  (varianceNow * varianceNow / std::max(1, now.n - 1) + varianceBefore * varianceBefore / std::max(1, before.n - 1))
+            : 1;
+        double margin = tCritical(confidence, degreesOfFreedom) * standardError;
+        double difference = now.mean - before.mean;
+        double change = difference / before.mean;
+
+        const char* verdict = "ok";
+        if (difference - margin > minSlowdown * before.mean) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (difference + margin < 0) {
+            verdict = "faster";
+        }
+        char interval[64];
+        std::snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", 100 * (difference - margin) / before.mean,
+                      100 * (difference + margin) / before.mean);
+        std::printf("%-24s %12.6f %12.6f %+7.1f%% %26s  %s\n", entry.first.c_str(), before.mean, now.mean, 100 * change, interval, verdict);
+    }
+
+    if (missing > 0) {
+        std::printf("%d benchmark(s) not in the baseline; record a new one with --write-baseline, or pass --allow-new.\n", missing);
+    }
+    if (regressions > 0) {
+        std::printf("%d benchmark(s) regressed.\n", regressions);
+    }
+    if (missing > 0 || regressions > 0) {
+        return 1;
+    }
+    std::printf("No significant regressions.\n");
+    return 0;
+}
+
+void printBenchUsage(const char* program) {
+    std::cerr << "Usage: " << program << " threads [MAX_THREADS] | sweep [CSV_FILE] [BUDGET_SECONDS] | fill |\n"
+              << "       compare [BASELINE_JSON] [--write-baseline] [--allow-new] [--repetitions N]\n"
+              << "  threads  run a fixed job, then fill one large grid, at 1, 2, 4, ... MAX_THREADS threads\n"
+              << "           (default: hardware threads)\n"
+              << "  sweep    time fills across grid sizes, banned list sizes and banned word lengths,\n"
+              << "           fit growth exponents and write CSV (default bench_sweep.csv, 1 second budget per point)\n"
+              << "  fill     compare the rejection, repair, tile and balanced fills on small alphabets and dense banned lists\n"
+              << "  compare  run the regression suite and fail on significant slowdowns against the baseline\n"
+              << "           (default tests/bench_baseline.json, 10 repetitions); --write-baseline records a new one,\n"
+              << "           and --allow-new lets benchmarks missing from the baseline pass instead of failing\n";
+}
+
+int main(int argc, char* argv[]) {
+    currentLogLevel = LogLevel::ERROR;
+
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "threads") {
+        int maxThreads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+        benchThreadScaling(std::max(1, maxThreads));
+        benchParallelFill(std::max(1, maxThreads));
+    } else if (mode == "sweep") {
+        std::string csvFile = argc > 2 ? argv[2] : "bench_sweep.csv";
+        double budgetSeconds = argc > 3 ? std::atof(argv[3]) : 1.0;
+        benchComplexitySweep(csvFile, budgetSeconds);
+    } else if (mode == "fill") {
+        benchFillModes();
+    } else if (mode == "compare") {
+        std::string baselineFile = "tests/bench_baseline.json";
+        bool writeNewBaseline = false;
+        bool allowNew = false;
+        int repetitions = 10;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--write-baseline") {
+                writeNewBaseline = true;
+            } else if (arg == "--allow-new") {
+                allowNew = true;
+            } else if (arg == "--repetitions" && i + 1 < argc) {
+                repetitions = std::max(2, std::atoi(argv[++i]));
+            } else {
+                baselineFile = arg;
+            }
+        }
+        return benchCompare(baselineFile, writeNewBaseline, repetitions, allowNew);
+    } else {
+        printBenchUsage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
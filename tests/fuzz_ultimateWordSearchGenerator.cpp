@@ -0,0 +1,208 @@
+/*
+ * Ultimate Word Search Generator
+ * Copyright (C) 2024  Alexandra Dogwood
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: hello@adogwood.com
+ */
+
+// Fuzz harness for the Ultimate Word Search Generator. Each input is read as
+// the answers to the interactive prompts; jobs that parse are generated and
+// checked, some on wrap-around grids: generation finishes within the time
+// budget, no banned word runs through a filled cell, and every placed word
+// is still in the grid.
+//
+// With libFuzzer (clang):
+//   clang++ -std=c++11 -g -O1 -fsanitize=fuzzer,address -DWORDSEARCH_LIBFUZZER tests/fuzz_ultimateWordSearchGenerator.cpp -o fuzz_wordsearch
+//   ./fuzz_wordsearch -timeout=2
+// Without it, the harness has its own driver that replays the files given
+// on the command line, or else runs a number of random inputs:
+//   g++ -std=c++11 -g -O1 -fsanitize=address,undefined -pthread tests/fuzz_ultimateWordSearchGenerator.cpp -o fuzz_wordsearch
+//   ./fuzz_wordsearch [FILE...] [--runs N]
+
+#define WORDSEARCH_NO_MAIN
+#include "../ultimateWordSearchGenerator.cpp"
+
+namespace {
+
+// Keep each input well inside the fuzzer's timeout
+const int maxFuzzCells = 32 * 32;
+const std::size_t maxFuzzWords = 32;
+const std::size_t maxFuzzWordLength = 16;
+const double maxFuzzSeconds = 1.0;
+
+void fail(const char* invariant, const PuzzleJob& job, const WordSearch& ws) {
+    std::cerr << "Invariant failed: " << invariant << "\n"
+              << "rows=" << job.rows << " cols=" << job.cols << " letters=" << job.letters.size()
+              << " words=" << job.words.size() << " banned=" << job.bannedWords.size() << "\n";
+    ws.printGrid(std::cerr);
+    std::abort();
+}
+
+bool fitsBudget(const PuzzleJob& job) {
+    if (job.rows * job.cols > maxFuzzCells || job.words.size() > maxFuzzWords || job.bannedWords.size() > maxFuzzWords) {
+        return false;
+    }
+    for (const auto& word : job.words) {
+        if (word.size() > maxFuzzWordLength) {
+            return false;
+        }
+    }
+    for (const auto& word : job.bannedWords) {
+        if (word.size() > maxFuzzWordLength) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    currentLogLevel = LogLevel::ERROR;
+    std::istringstream in(std::string(reinterpret_cast<const char*>(data), size));
+    PuzzleJob job;
+    std::string error;
+    if (!readJob(in, nullptr, job, error) || !fitsBudget(job)) {
+        return 0;
+    }
+
+    // Every fill keeps the same invariants. A job builds its tile library
+    // once for all its puzzles, so that is left out of the time budget; it
+    // is slow enough to try the tile fill on only some inputs.
+    FillMode mode = size % 8 == 0 ? FillMode::Tiles : size % 8 == 4 ? FillMode::Balanced
+                  : size % 2 ? FillMode::Repair : FillMode::Rejection;
+    std::shared_ptr<const TileLibrary> tiles;
+    if (mode == FillMode::Tiles) {
+        tiles = TileLibrary::load("", job.letters, job.bannedWords, BannedWordMatcher(job.bannedWords, gridAlphabet(job.letters, job.words)));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    WordSearch ws(job.rows, job.cols, job.words, job.letters, job.bannedWords, static_cast<unsigned>(size));
+    ws.setFillMode(mode, tiles);
+    ws.setShadowGrids(size % 3 == 0);
+    ws.setWrapAround(size % 5 == 0); // Stays rectangular if some word is too long to wrap
+    ws.placeWords();
+
+    // Cells covered by a placed word, which may wrap around; the fill never
+    // writes these
+    std::vector<std::vector<bool>> placed(job.rows, std::vector<bool>(job.cols, false));
+    for (const auto& placement : ws.placements()) {
+        const std::string& word = ws.word(placement);
+        for (int i = 0; i < static_cast<int>(word.size()); ++i) {
+            placed[(placement.row + placement.dr * i + job.rows) % job.rows][(placement.col + placement.dc * i + job.cols) % job.cols] = true;
+        }
+    }
+
+    bool filled = ws.fillGrid();
+    if (microsSince(start) > maxFuzzSeconds * 1e6) {
+        fail("generation finishes within the time budget", job, ws);
+    }
+
+    int emptyCells = 0;
+    for (int r = 0; r < job.rows; ++r) {
+        for (int c = 0; c < job.cols; ++c) {
+            if (ws.cell(r, c) == ' ') {
+                ++emptyCells;
+            } else if (!placed[r][c] && ws.referenceBannedWordAt(r, c)) {
+                fail("no banned word runs through a filled cell", job, ws);
+            }
+        }
+    }
+    if (emptyCells != ws.stats().unfilledCells || filled != (emptyCells == 0)) {
+        fail("only cells reported as unfillable are left empty", job, ws);
+    }
+
+    for (const auto& placement : ws.placements()) {
+        const std::string& word = ws.word(placement);
+        for (int i = 0; i < static_cast<int>(word.size()); ++i) {
+            if (ws.cell(placement.row + placement.dr * i, placement.col + placement.dc * i) != word[i]) {
+                fail("placed words are present", job, ws);
+            }
+        }
+    }
+    return 0;
+}
+
+#ifndef WORDSEARCH_LIBFUZZER
+// A random input in the shape of the prompts' answers, so most of them parse
+// and reach generation. Small alphabets and short banned words make cells
+// that no letter can fill common.
+std::string randomInput(std::mt19937& rng) {
+    auto pick = [&](int bound) { return static_cast<int>(rng() % bound); };
+    const std::string pool = "ABCDE";
+    int alphabetSize = 1 + pick(pool.size());
+    auto randomWord = [&](int maxLength) {
+        std::string word(1 + pick(maxLength), ' ');
+        for (auto& letter : word) {
+            letter = pool[pick(alphabetSize + 1) % pool.size()]; // Occasionally outside the alphabet
+        }
+        return word;
+    };
+
+    std::ostringstream input;
+    input << pick(14) - 1 << " " << pick(14) - 1 << "\n"; // Includes zero and negative sizes
+    for (int i = 0; i < alphabetSize; ++i) {
+        input << pool[i] << " ";
+    }
+    input << "\n";
+    for (int i = pick(6); i > 0; --i) {
+        input << randomWord(8) << " ";
+    }
+    input << "done\n";
+    for (int i = pick(5); i > 0; --i) {
+        // Some also ban near-spellings, and some are only discouraged
+        static const char* const marks[] = { "", "", "~", "?" };
+        input << marks[pick(4)] << randomWord(3) << " ";
+    }
+    input << "done\n1\nfuzz.txt\n";
+    std::string text = input.str();
+    if (pick(8) == 0) {
+        text[pick(text.size())] = static_cast<char>(rng()); // Corrupt one byte
+    }
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    int runs = 100000;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::atoi(argv[++i]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    for (const auto& path : files) {
+        std::ifstream file(path, std::ios::binary);
+        std::string input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(input.data()), input.size());
+    }
+    if (!files.empty()) {
+        std::cout << "Replayed " << files.size() << " input(s).\n";
+        return 0;
+    }
+
+    std::mt19937 rng(86);
+    for (int run = 0; run < runs; ++run) {
+        std::string input = randomInput(rng);
+        LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(input.data()), input.size());
+    }
+    std::cout << "Ran " << runs << " random input(s).\n";
+    return 0;
+}
+#endif
@@ -0,0 +1,1138 @@
+/*
+ * Ultimate Word Search Generator
+ * Copyright (C) 2024  Alexandra Dogwood
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contact: hello@adogwood.com
+ */
+
+// Tests for the Ultimate Word Search Generator. Build and run from the
+// repository root:
+//   g++ -std=c++11 -O2 -pthread tests/test_ultimateWordSearchGenerator.cpp -o test_wordsearch
+//   ./test_wordsearch
+
+#define WORDSEARCH_NO_MAIN
+#define WORDSEARCH_COUNT_ALLOCATIONS // Needed by the allocation test
+#include "../ultimateWordSearchGenerator.cpp"
+
+#include <functional>
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition "\n"; \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (0)
+
+// Percentiles must land within the histogram's bucket precision of the truth
+void testLatencyHistogramPercentiles() {
+    LatencyHistogram histogram;
+    for (std::uint64_t value = 1; value <= 100000; ++value) {
+        histogram.record(value);
+    }
+    CHECK(histogram.count() == 100000);
+    CHECK(histogram.max() == 100000);
+
+    const double percents[] = { 50.0, 90.0, 99.0, 99.9 };
+    for (double percent : percents) {
+        double expected = percent * 1000.0;
+        double reported = static_cast<double>(histogram.percentile(percent));
+        CHECK(reported >= expected);
+        CHECK(reported <= expected * 1.04);
+    }
+
+    LatencyHistogram other;
+    other.record(5000000);
+    histogram.merge(other);
+    CHECK(histogram.count() == 100001);
+    CHECK(histogram.percentile(100.0) == 5000000);
+}
+
+// Placing words and filling the grid must not touch the heap once the
+// puzzle is constructed, or every puzzle pays for it many times over
+void testHotPathDoesNotAllocate() {
+    std::vector<std::string> words = { "ABCD", "DCBA", "BAD" };
+    std::vector<char> letters = { 'A', 'B', 'C', 'E' };
+    std::unordered_set<std::string> bannedWords = { "EAE", "BEB" }; // Only the fill can spell these
+
+    WordSearch warmUp(20, 20, words, letters, bannedWords);
+    warmUp.generate(); // First use initializes function-local statics
+
+    WordSearch ws(20, 20, words, letters, bannedWords);
+    AllocationCounts before = currentThreadAllocations();
+    ws.generate();
+    AllocationCounts allocated = currentThreadAllocations() - before;
+    CHECK(ws.stats().wordsFailed == 0);
+    CHECK(allocated.allocations == 0);
+    CHECK(allocated.bytes == 0);
+}
+
+// An optimized banned-word backend: its whole-grid scan and its check for a
+// banned word through one cell
+struct MatcherBackend {
+    const char* name;
+    std::function<bool(const WordSearch&)> anywhere;
+    std::function<bool(const WordSearch&, int, int)> at;
+};
+
+std::vector<MatcherBackend> matcherBackends() {
+    return {
+        { "automaton",
+          [](const WordSearch& ws) { return ws.bannedWordAnywhere(); },
+          [](const WordSearch& ws, int r, int c) { return ws.bannedWordAt(r, c); } },
+        { "automaton over shadow grids",
+          [](const WordSearch& ws) {
+              WordSearch shadowed = ws;
+              shadowed.setShadowGrids(true);
+              return shadowed.bannedWordAnywhere();
+          },
+          [](const WordSearch& ws, int r, int c) {
+              WordSearch shadowed = ws;
+              shadowed.setShadowGrids(true);
+              return shadowed.bannedWordAt(r, c);
+          } },
+    };
+}
+
+void printCase(const std::vector<std::string>& lines, const std::unordered_set<std::string>& bannedWords) {
+    std::cerr << "  banned:";
+    for (const auto& word : bannedWords) {
+        std::cerr << " " << word;
+    }
+    std::cerr << "\n  grid:\n";
+    for (const auto& line : lines) {
+        std::cerr << "    |" << line << "|\n";
+    }
+}
+
+// Random grids, alphabets and banned lists: every backend must report exactly
+// the hits of the reference canFormWord scans, for the whole grid and per cell
+void testMatcherBackendsAgreeWithReference() {
+    std::mt19937 rng(83);
+    const std::string pool = "ABCDEFG";
+    int mismatchedCases = 0;
+
+    for (int iteration = 0; iteration < 3000; ++iteration) {
+        std::string alphabet = pool.substr(0, 1 + rng() % 5);
+        int rows = 1 + rng() % 10;
+        int cols = 1 + rng() % 10;
+
+        std::unordered_set<std::string> bannedWords;
+        int bannedCount = rng() % 6;
+        for (int i = 0; i < bannedCount; ++i) {
+            std::string word(1 + rng() % 5, ' ');
+            for (auto& letter : word) {
+                letter = rng() % 20 == 0 ? 'Z' : alphabet[rng() % alphabet.size()]; // 'Z' never appears in the grid
+            }
+            int kind = rng() % 6;
+            // Some also ban near-spellings; some are only discouraged, which no backend reports
+            bannedWords.insert(kind < 2 ? "~" + word : kind == 2 ? "?" + word + ":" + std::to_string(1 + rng() % 3) : word);
+        }
+
+        std::vector<std::string> lines(rows, std::string(cols, ' '));
+        for (auto& line : lines) {
+            for (auto& cell : line) {
+                if (rng() % 10 != 0) { // Leave some cells empty, as during the fill
+                    cell = alphabet[rng() % alphabet.size()];
+                }
+            }
+        }
+
+        WordSearch ws(rows, cols, std::vector<std::string>(), std::vector<char>(alphabet.begin(), alphabet.end()), bannedWords, 1);
+        ws.setGrid(lines);
+
+        for (const auto& backend : matcherBackends()) {
+            bool agrees = backend.anywhere(ws) == ws.referenceContainsBannedWords();
+            for (int r = 0; r < rows && agrees; ++r) {
+                for (int c = 0; c < cols && agrees; ++c) {
+                    agrees = backend.at(ws, r, c) == ws.referenceBannedWordAt(r, c);
+                }
+            }
+            agrees = agrees && ws.discouragedPenaltyAnywhere() == ws.referenceDiscouragedPenalty();
+            if (!agrees && ++mismatchedCases <= 3) {
+                std::cerr << "Backend " << backend.name << " disagrees with the reference:\n";
+                printCase(lines, bannedWords);
+            }
+        }
+
+        // The same grid wrapped around, when the banned words fit it
+        WordSearch wrapped = ws;
+        if (wrapped.setWrapAround(true)) {
+            bool agrees = wrapped.bannedWordAnywhere() == wrapped.referenceContainsBannedWords() &&
+                          wrapped.discouragedPenaltyAnywhere() == wrapped.referenceDiscouragedPenalty();
+            for (int r = 0; r < rows && agrees; ++r) {
+                for (int c = 0; c < cols && agrees; ++c) {
+                    agrees = wrapped.bannedWordAt(r, c) == wrapped.referenceBannedWordAt(r, c);
+                }
+            }
+            if (!agrees && ++mismatchedCases <= 3) {
+                std::cerr << "The automaton disagrees with the reference on a wrap-around grid:\n";
+                printCase(lines, bannedWords);
+            }
+        }
+    }
+    CHECK(mismatchedCases == 0);
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// A fixed-seed job must write byte-identical output whatever the number of
+// workers and whichever writer backend is used
+void testOutputIsDeterministicAcrossThreadsAndWriters() {
+    PuzzleJob job;
+    job.numPuzzles = 24;
+    job.rows = 15;
+    job.cols = 12;
+    job.words = { "ABBA", "CAD", "DAD", "BCDA", "ACDC" };
+    job.letters = { 'A', 'B', 'C', 'D' };
+    job.bannedWords = { "ABCA", "CBAB", "BACC" };
+    job.seed = 84;
+
+    const int threadCounts[] = { 1, 4, 16 };
+    const WriterMode writerModes[] = { WriterMode::Locked, WriterMode::Queued };
+    const std::string path = "test_determinism_output.txt";
+    std::string expected;
+    for (int threads : threadCounts) {
+        for (WriterMode mode : writerModes) {
+            job.numThreads = threads;
+            job.writerMode = mode;
+            job.outputFile = path;
+            generatePuzzles(job);
+            std::string output = readFile(path);
+            if (expected.empty()) {
+                expected = output;
+                CHECK(output.find("Puzzle 24:\n") != std::string::npos);
+            }
+            if (output != expected) {
+                std::cerr << "Output differs with " << threads << " threads and the "
+                          << (mode == WriterMode::Locked ? "locked" : "queued") << " writer\n";
+                ++failures;
+            }
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// The first count puzzles of a job's output
+std::string outputPrefix(const std::string& output, int count) {
+    size_t end = output.find("Puzzle " + std::to_string(count + 1) + ":\n");
+    return end == std::string::npos ? output : output.substr(0, end);
+}
+
+// Many small jobs at once, each with its own pool, writer and a cancellation
+// that lands at a random moment, while metrics are exported and every worker
+// logs. Meant to be built with -fsanitize=thread as well; without it this
+// still checks that cancelled jobs write a clean prefix of their output and
+// that log lines never interleave.
+void testConcurrentJobsWithCancellation() {
+    const int clients = 6;
+    const int rounds = 12;
+    std::mt19937 rng(85);
+
+    PuzzleJob base;
+    base.numPuzzles = 30;
+    base.rows = 20;
+    base.cols = 20;
+    base.words = { "ABBA", "CAD", "DAD" };
+    base.letters = { 'A', 'B', 'C', 'D' };
+    base.bannedWords = { "ABCA", "CBAB" };
+
+    // Uncancelled single-threaded output for each client's seed
+    std::vector<std::string> expected(clients);
+    for (int c = 0; c < clients; ++c) {
+        PuzzleJob job = base;
+        job.seed = 850 + c;
+        job.numThreads = 1;
+        job.outputFile = "test_stress_" + std::to_string(c) + ".txt";
+        generatePuzzles(job);
+        expected[c] = readFile(job.outputFile);
+    }
+
+    std::ostringstream logged;
+    std::streambuf* console = std::cout.rdbuf(logged.rdbuf());
+    LogLevel savedLevel = currentLogLevel;
+    currentLogLevel = LogLevel::INFO; // Every puzzle logs, from every worker
+
+    std::atomic<bool> exporting(true);
+    std::thread exporter([&] {
+        while (exporting) {
+            std::ostringstream out;
+            writePrometheusMetrics(out);
+        }
+    });
+
+    int badOutputs = 0;
+    for (int round = 0; round < rounds; ++round) {
+        std::vector<PuzzleJob> jobs(clients, base);
+        std::vector<std::unique_ptr<std::atomic<bool>>> cancels;
+        std::vector<int> cancelDelays;
+        for (int c = 0; c < clients; ++c) {
+            cancels.emplace_back(new std::atomic<bool>(false));
+            jobs[c].seed = 850 + c;
+            jobs[c].numThreads = 1 + rng() % 8;
+            jobs[c].writerMode = rng() % 2 ? WriterMode::Queued : WriterMode::Locked;
+            jobs[c].outputFile = "test_stress_" + std::to_string(c) + ".txt";
+            jobs[c].cancel = cancels[c].get();
+            cancelDelays.push_back(rng() % 3 == 0 ? -1 : static_cast<int>(rng() % 3000)); // Microseconds, -1 never
+        }
+
+        std::vector<JobStats> results(clients);
+        std::vector<std::thread> threads;
+        for (int c = 0; c < clients; ++c) {
+            threads.emplace_back([&, c] { results[c] = generatePuzzles(jobs[c]); });
+            if (cancelDelays[c] >= 0) {
+                threads.emplace_back([&, c] {
+                    std::this_thread::sleep_for(std::chrono::microseconds(cancelDelays[c]));
+                    *cancels[c] = true;
+                });
+            }
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (int c = 0; c < clients; ++c) {
+            int generated = results[c].puzzlesGenerated;
+            bool complete = cancelDelays[c] >= 0 || generated == base.numPuzzles;
+            if (!complete || generated > base.numPuzzles ||
+                readFile(jobs[c].outputFile) != outputPrefix(expected[c], generated)) {
+                ++badOutputs;
+            }
+        }
+    }
+
+    exporting = false;
+    exporter.join();
+    currentLogLevel = savedLevel;
+    std::cout.rdbuf(console);
+
+    CHECK(badOutputs == 0);
+    std::istringstream lines(logged.str());
+    std::string line;
+    int badLines = 0;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 7, "[INFO] ") != 0 && line.compare(0, 7, "[WARN] ") != 0) {
+            ++badLines;
+        }
+    }
+    CHECK(badLines == 0);
+    for (int c = 0; c < clients; ++c) {
+        std::remove(("test_stress_" + std::to_string(c) + ".txt").c_str());
+    }
+}
+
+// A word that fits in only a couple of slots is always placed: once random
+// probes miss, every slot is checked
+void testPlacementFindsRareSlots() {
+    std::vector<std::string> lines(10, std::string(10, 'X'));
+    lines[4] = "     XXXXX"; // ABCDE fits here left to right or right to left, and nowhere else
+    int placed = 0;
+    std::uint64_t slotScans = 0;
+    for (unsigned seed = 0; seed < 200; ++seed) {
+        WordSearch ws(10, 10, { "ABCDE" }, { 'A' }, {}, seed);
+        ws.setGrid(lines);
+        ws.placeWords();
+        placed += ws.stats().wordsPlaced;
+        slotScans += ws.stats().slotScans;
+    }
+    CHECK(placed == 200);
+    CHECK(slotScans > 0);
+
+    WordSearch tooLong(1, 19, { "ABCDEFGHIJKLMNOPQRST" }, { 'A' }, {}, 88);
+    tooLong.placeWords();
+    CHECK(tooLong.stats().wordsFailed == 1);
+}
+
+bool sameSlot(const WordPlacement& a, const WordPlacement& b) {
+    return a.row == b.row && a.col == b.col && a.dr == b.dr && a.dc == b.dc;
+}
+
+// The bitboard slot search must find exactly the slots a cell-by-cell check
+// accepts, in the same order, including rows longer than one 64-bit word
+void testBitboardSlotsMatchReference() {
+    std::mt19937 rng(90);
+    const std::string alphabet = "ABC";
+    int mismatchedCases = 0;
+    for (int iteration = 0; iteration < 400; ++iteration) {
+        int rows = 1 + rng() % 12;
+        int cols = 1 + rng() % (iteration % 4 == 0 ? 200 : 20);
+        std::vector<std::string> words;
+        for (int i = 0; i < 3; ++i) {
+            std::string word(1 + rng() % 6, ' ');
+            for (auto& letter : word) {
+                letter = alphabet[rng() % alphabet.size()];
+            }
+            words.push_back(word);
+        }
+
+        std::vector<std::string> lines(rows, std::string(cols, ' '));
+        for (auto& line : lines) {
+            for (auto& cell : line) {
+                if (rng() % 3 == 0) {
+                    cell = rng() % 8 == 0 ? 'Z' : alphabet[rng() % alphabet.size()]; // 'Z' is in no word
+                }
+            }
+        }
+
+        WordSearch ws(rows, cols, words, { 'A' }, {}, 1);
+        WordSearch wrapped(rows, cols, words, { 'A' }, {}, 1);
+        bool wraps = wrapped.setWrapAround(true); // When the words fit the grid's shorter side
+        ws.setGrid(lines);
+        wrapped.setGrid(lines);
+        for (const auto& word : words) {
+            for (const WordSearch* grid : { &ws, wraps ? &wrapped : nullptr }) {
+                if (!grid) {
+                    continue;
+                }
+                auto slots = grid->fittingSlots(word);
+                auto expected = grid->referenceFittingSlots(word);
+                bool same = slots.size() == expected.size() && std::equal(slots.begin(), slots.end(), expected.begin(), sameSlot);
+                if (!same && ++mismatchedCases <= 3) {
+                    std::cerr << "Bitboard slots for " << word << (grid == &wrapped ? " on a wrap-around grid" : "")
+                              << " differ from the reference (" << slots.size() << " vs " << expected.size() << "):\n";
+                    printCase(lines, {});
+                }
+            }
+        }
+    }
+    CHECK(mismatchedCases == 0);
+}
+
+// A deadline that has already passed skips placement and then the fill:
+// missing words alone degrade a puzzle, empty cells fail it
+void testPuzzleDeadlines() {
+    std::vector<std::string> words = { "ABCD", "DCBA", "BAD" };
+    std::vector<char> letters = { 'A', 'B', 'C', 'E' };
+    auto past = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    auto future = std::chrono::steady_clock::now() + std::chrono::hours(1);
+
+    WordSearch degraded(12, 12, words, letters, {}, 87);
+    degraded.setDeadlines(past, future);
+    CHECK(degraded.generate());
+    CHECK(degraded.placements().empty());
+    CHECK(degraded.stats().wordsSkipped == 3);
+    CHECK(degraded.result() == PuzzleResult::Degraded);
+
+    WordSearch failed(12, 12, words, letters, {}, 87);
+    failed.setDeadlines(future, past);
+    CHECK(!failed.generate());
+    CHECK(failed.stats().wordsPlaced == 3);
+    CHECK(failed.stats().unfilledCells > 0);
+    CHECK(failed.result() == PuzzleResult::Failed);
+
+    WordSearch complete(12, 12, words, letters, {}, 87);
+    complete.setDeadlines(future, future);
+    CHECK(complete.generate());
+    CHECK(complete.result() == PuzzleResult::Complete);
+}
+
+// Under the retry policy a puzzle that cannot be completed is attempted
+// maxAttempts times, then written flagged as failed
+void testRetryPolicy() {
+    PuzzleJob job;
+    job.numPuzzles = 2;
+    job.rows = 6;
+    job.cols = 6;
+    job.letters = { 'A', 'B' };
+    job.bannedWords = { "AA", "BB", "AB" }; // No two letters can be neighbours
+    job.outputFile = "test_retry_output.txt";
+    job.seed = 87;
+    job.numThreads = 1;
+    job.deadlinePolicy = DeadlinePolicy::Retry;
+    job.maxAttempts = 3;
+
+    std::uint64_t retriesBefore = metrics.puzzleRetries;
+    JobStats stats = generatePuzzles(job);
+    CHECK(stats.puzzlesFailed == 2);
+    CHECK(metrics.puzzleRetries - retriesBefore == 4);
+    CHECK(readFile(job.outputFile).find("Puzzle 2 (failed):\n") != std::string::npos);
+    std::remove(job.outputFile.c_str());
+}
+
+void testRepairFillLeavesNoBannedWords() {
+    std::mt19937 rng(91);
+    const std::string alphabet = "ABC";
+    int badCases = 0;
+    std::uint64_t repairSteps = 0;
+    for (int iteration = 0; iteration < 300; ++iteration) {
+        int rows = 1 + rng() % 16;
+        int cols = 1 + rng() % 16;
+        std::vector<char> letters(alphabet.begin(), alphabet.begin() + 1 + rng() % alphabet.size());
+        std::unordered_set<std::string> banned;
+        for (int i = rng() % 5; i > 0; --i) {
+            std::string word(1 + rng() % 4, ' ');
+            for (auto& letter : word) {
+                letter = alphabet[rng() % alphabet.size()];
+            }
+            banned.insert(word);
+        }
+        std::vector<std::string> lines(rows, std::string(cols, ' '));
+        for (auto& line : lines) {
+            for (auto& cell : line) {
+                if (rng() % 6 == 0) {
+                    cell = alphabet[rng() % alphabet.size()];
+                }
+            }
+        }
+
+        unsigned seed = rng();
+        std::vector<std::string> grids;
+        for (int run = 0; run < 2; ++run) {
+            WordSearch ws(rows, cols, {}, letters, banned, seed);
+            ws.setGrid(lines);
+            ws.setFillMode(FillMode::Repair);
+            bool filled = ws.fillGrid();
+            repairSteps += ws.stats().repairSteps;
+
+            // Cells the fill wrote hold no banned word; cells it left empty are counted
+            int emptyCells = 0;
+            bool bannedWordFilled = false;
+            std::string grid;
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < cols; ++c) {
+                    grid += ws.cell(r, c);
+                    if (ws.cell(r, c) == ' ') {
+                        ++emptyCells;
+                    } else if (lines[r][c] == ' ' && ws.referenceBannedWordAt(r, c)) {
+                        bannedWordFilled = true;
+                    }
+                }
+            }
+            grids.push_back(grid);
+            bool bad = bannedWordFilled || emptyCells != ws.stats().unfilledCells || filled != (emptyCells == 0);
+            if (bad && ++badCases <= 3) {
+                std::cerr << "Repair fill left a banned word or miscounted empty cells:\n";
+                printCase(lines, banned);
+                ws.printGrid(std::cerr);
+            }
+        }
+        CHECK(grids[0] == grids[1]); // Same seed, same fill
+    }
+    CHECK(badCases == 0);
+    CHECK(repairSteps > 0);
+}
+
+void testTileFillLeavesNoBannedWords() {
+    std::mt19937 rng(92);
+    const std::string alphabet = "ABCD";
+    int badCases = 0;
+    int tilesPlaced = 0;
+    for (int iteration = 0; iteration < 40; ++iteration) {
+        std::vector<char> letters(alphabet.begin(), alphabet.begin() + 2 + rng() % 3);
+        std::unordered_set<std::string> banned;
+        for (int i = rng() % 6; i > 0; --i) {
+            std::string word(2 + rng() % 4, ' ');
+            for (auto& letter : word) {
+                letter = alphabet[rng() % alphabet.size()];
+            }
+            banned.insert(word);
+        }
+        auto matcher = std::make_shared<const BannedWordMatcher>(banned);
+        auto tiles = TileLibrary::load("", letters, banned, *matcher);
+
+        // Tiles hold no banned word, and neither do pairs the library allows
+        int side = tiles->side();
+        auto tileGrid = [&](int tile, int rowOffset, int colOffset, std::vector<std::string>& lines) {
+            for (int r = 0; r < side; ++r) {
+                for (int c = 0; c < side; ++c) {
+                    lines[rowOffset + r][colOffset + c] = tiles->letter(tile, r, c);
+                }
+            }
+        };
+        for (int t = 0; t < tiles->count() && iteration % 8 == 0; ++t) {
+            std::vector<std::string> lines(side, std::string(side, ' '));
+            tileGrid(t, 0, 0, lines);
+            WordSearch ws(side, side, {}, letters, banned, 1, matcher);
+            ws.setGrid(lines);
+            CHECK(!ws.referenceContainsBannedWords());
+        }
+        for (int sample = 0; sample < 20 && tiles->count() > 0; ++sample) {
+            int a = rng() % tiles->count();
+            int b = rng() % tiles->count();
+            std::vector<std::string> beside(side, std::string(2 * side, ' '));
+            tileGrid(a, 0, 0, beside);
+            tileGrid(b, 0, side, beside);
+            WordSearch besideGrid(side, 2 * side, {}, letters, banned, 1, matcher);
+            besideGrid.setGrid(beside);
+            CHECK(tiles->fitsRightOf(a, b) == !besideGrid.referenceContainsBannedWords());
+            std::vector<std::string> stacked(2 * side, std::string(side, ' '));
+            tileGrid(a, 0, 0, stacked);
+            tileGrid(b, side, 0, stacked);
+            WordSearch stackedGrid(2 * side, side, {}, letters, banned, 1, matcher);
+            stackedGrid.setGrid(stacked);
+            CHECK(tiles->fitsBelow(a, b) == !stackedGrid.referenceContainsBannedWords());
+        }
+
+        // Filled cells hold no banned word, whatever words were already in the grid
+        int rows = 1 + rng() % 30;
+        int cols = 1 + rng() % 30;
+        std::vector<std::string> lines(rows, std::string(cols, ' '));
+        for (int i = rng() % 4; i > 0; --i) {
+            int r = rng() % rows;
+            int c = rng() % cols;
+            for (int k = 0; k < 5 && c + k < cols; ++k) {
+                lines[r][c + k] = alphabet[rng() % alphabet.size()]; // A placed word, leaving most blocks empty
+            }
+        }
+        WordSearch ws(rows, cols, {}, letters, banned, rng(), matcher);
+        ws.setGrid(lines);
+        ws.setFillMode(FillMode::Tiles, tiles);
+        bool filled = ws.fillGrid();
+        tilesPlaced += ws.stats().tilesPlaced;
+        int emptyCells = 0;
+        bool bannedWordFilled = false;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (ws.cell(r, c) == ' ') {
+                    ++emptyCells;
+                } else if (lines[r][c] == ' ' && ws.referenceBannedWordAt(r, c)) {
+                    bannedWordFilled = true;
+                }
+            }
+        }
+        bool bad = bannedWordFilled || emptyCells != ws.stats().unfilledCells || filled != (emptyCells == 0);
+        if (bad && ++badCases <= 3) {
+            std::cerr << "Tile fill left a banned word or miscounted empty cells:\n";
+            printCase(lines, banned);
+            ws.printGrid(std::cerr);
+        }
+    }
+    CHECK(badCases == 0);
+    CHECK(tilesPlaced > 0);
+
+    // A cached library loads back the same, and only for the same inputs
+    std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    std::unordered_set<std::string> banned = { "ABCA", "CBAB", "BACC" };
+    BannedWordMatcher matcher(banned);
+    std::string path = TileLibrary::cachePath(".", letters, banned);
+    std::remove(path.c_str());
+    auto built = TileLibrary::load(".", letters, banned, matcher);
+    CHECK(!readFile(path).empty());
+    auto loaded = TileLibrary::load(".", letters, banned, matcher);
+    bool same = built->count() == loaded->count() && built->count() > 0;
+    for (int t = 0; same && t < built->count(); ++t) {
+        for (int u = 0; u < built->count(); ++u) {
+            same = same && built->fitsRightOf(t, u) == loaded->fitsRightOf(t, u) && built->fitsBelow(t, u) == loaded->fitsBelow(t, u);
+        }
+        for (int r = 0; r < built->side(); ++r) {
+            for (int c = 0; c < built->side(); ++c) {
+                same = same && built->letter(t, r, c) == loaded->letter(t, r, c);
+            }
+        }
+    }
+    CHECK(same);
+    CHECK(TileLibrary::cachePath(".", letters, { "ABCA" }) != path);
+    std::remove(path.c_str());
+}
+
+// Filling in blocks on several threads gives the same grid whatever the
+// number of threads, and no banned word runs through a filled cell, also
+// when banned words are longer than the smallest block
+void testParallelFillIsDeterministic() {
+    std::mt19937 rng(93);
+    const std::string alphabet = "ABC";
+    int badCases = 0;
+    for (int iteration = 0; iteration < 12; ++iteration) {
+        int rows = 1 + rng() % 150;
+        int cols = 1 + rng() % 150;
+        std::unordered_set<std::string> banned;
+        for (int i = 1 + rng() % 6; i > 0; --i) {
+            std::string word(2 + rng() % (iteration % 3 == 0 ? 45 : 4), ' ');
+            for (auto& letter : word) {
+                letter = alphabet[rng() % alphabet.size()];
+            }
+            banned.insert(word);
+        }
+        std::vector<std::string> lines(rows, std::string(cols, ' '));
+        for (auto& line : lines) {
+            for (auto& cell : line) {
+                if (rng() % 10 == 0) {
+                    cell = alphabet[rng() % alphabet.size()];
+                }
+            }
+        }
+
+        unsigned seed = rng();
+        std::vector<std::string> grids;
+        for (int threads : { 1, 2, 5 }) {
+            WordSearch ws(rows, cols, {}, { 'A', 'B', 'C' }, banned, seed);
+            ws.setGrid(lines);
+            ws.setFillThreads(threads);
+            bool filled = ws.fillGrid();
+            int emptyCells = 0;
+            bool bannedWordFilled = false;
+            std::string grid;
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < cols; ++c) {
+                    grid += ws.cell(r, c);
+                    if (ws.cell(r, c) == ' ') {
+                        ++emptyCells;
+                    } else if (lines[r][c] == ' ' && ws.referenceBannedWordAt(r, c)) {
+                        bannedWordFilled = true;
+                    }
+                }
+            }
+            grids.push_back(grid);
+            bool bad = bannedWordFilled || emptyCells != ws.stats().unfilledCells || filled != (emptyCells == 0);
+            if (bad && ++badCases <= 3) {
+                std::cerr << "Fill on " << threads << " threads left a banned word or miscounted empty cells in a "
+                          << rows << "x" << cols << " grid\n";
+            }
+        }
+        CHECK(grids[0] == grids[1] && grids[0] == grids[2]);
+    }
+    CHECK(badCases == 0);
+}
+
+// Banned words that cannot run through a filled cell are not checked for,
+// and skipping the checks does not change the puzzle
+void testFillSkipsImpossibleBannedWords() {
+    const std::vector<std::string> words = { "XYZZY", "ABBA" };
+    const std::vector<char> letters = { 'A', 'B', 'C' };
+    auto fill = [&](const std::unordered_set<std::string>& banned, std::uint64_t& checks) {
+        WordSearch ws(12, 9, words, letters, banned, 94);
+        ws.generate();
+        checks = ws.stats().bannedChecks;
+        std::ostringstream grid;
+        ws.printGrid(grid);
+        return grid.str();
+    };
+    std::uint64_t checks = 0;
+    std::string unchecked = fill({}, checks);
+    CHECK(checks == 0);
+    CHECK(fill({ "AQ", "BBQ" }, checks) == unchecked); // Q is neither a letter nor in a word
+    CHECK(checks == 0);
+    CHECK(fill({ "ABCABCABCABCA" }, checks) == unchecked); // Longer than any line
+    CHECK(checks == 0);
+    CHECK(fill({ "ZYX" }, checks) == unchecked); // Only word letters, so never through a filled cell
+    CHECK(checks == 0);
+    fill({ "ZA" }, checks); // A word letter next to a filled one
+    CHECK(checks > 0);
+}
+
+// A ~ entry bans its word and every spelling one edit away, but no shorter
+// spelling than fuzzyMinLength; puzzle words that are near-spellings are skipped
+void testFuzzyBannedWords() {
+    const std::vector<char> letters = { 'A', 'B', 'C', 'D', 'X' };
+    const std::unordered_set<std::string> banned = { "~ABCD" };
+    auto bannedIn = [&](const std::string& line) {
+        WordSearch ws(1, line.size(), {}, letters, banned, 1);
+        ws.setGrid({ line });
+        return ws.bannedWordAnywhere();
+    };
+    CHECK(bannedIn("XABCDX"));
+    CHECK(bannedIn("XABXDX")); // Substitution
+    CHECK(bannedIn("XXABDX")); // Deletion
+    CHECK(bannedIn("ABCCDX")); // Insertion
+    CHECK(bannedIn("XXDCBA")); // Reversed
+    CHECK(!bannedIn("ABXXDX"));
+    CHECK(!bannedIn("XABX DX")); // An empty cell is no letter
+
+    WordSearch shortWord(1, 6, {}, letters, { "~AB" }, 1);
+    shortWord.setGrid({ "AXDXBD" });
+    CHECK(!shortWord.bannedWordAnywhere()); // AX and XB are too short to be banned
+    shortWord.setGrid({ "DAXBDD" });
+    CHECK(shortWord.bannedWordAnywhere());
+
+    WordSearch ws(10, 10, { "ABXD", "CADB" }, letters, banned, 96);
+    ws.generate();
+    CHECK(ws.stats().wordsPlaced == 1); // ABXD is a near-spelling of ABCD
+    for (int r = 0; r < 10; ++r) {
+        for (int c = 0; c < 10; ++c) {
+            CHECK(ws.cell(r, c) == ' ' || !ws.referenceBannedWordAt(r, c));
+        }
+    }
+}
+
+// Discouraged words may appear but are kept rare, and the penalty each
+// fill adds up cell by cell is the weight of those in the finished grid
+void testDiscouragedWordsAreAvoided() {
+    const std::vector<char> letters = { 'A', 'B', 'C' };
+    const std::unordered_set<std::string> discouraged = { "CCC", "?AB:5", "?BB", "?CAC:2" };
+    const std::unordered_set<std::string> hardOnly = { "CCC" };
+    for (FillMode mode : { FillMode::Rejection, FillMode::Repair }) {
+        for (int threads : { 0, 2 }) {
+            WordSearch ws(20, 20, {}, letters, discouraged, 97);
+            ws.setFillMode(mode);
+            ws.setFillThreads(threads);
+            CHECK(ws.generate());
+            CHECK(ws.stats().discouragedPenalty == ws.referenceDiscouragedPenalty());
+            CHECK(ws.discouragedPenaltyAnywhere() == ws.referenceDiscouragedPenalty());
+
+            WordSearch unweighted(20, 20, {}, letters, hardOnly, 97);
+            unweighted.setFillMode(mode);
+            unweighted.setFillThreads(threads);
+            unweighted.generate();
+            std::vector<std::string> lines(20);
+            for (int r = 0; r < 20; ++r) {
+                for (int c = 0; c < 20; ++c) {
+                    lines[r] += unweighted.cell(r, c);
+                }
+            }
+            WordSearch scored(20, 20, {}, letters, discouraged, 1);
+            scored.setGrid(lines);
+            CHECK(ws.stats().discouragedPenalty * 4 < scored.referenceDiscouragedPenalty());
+        }
+    }
+
+    PuzzleJob job;
+    job.rows = job.cols = 5;
+    job.numPuzzles = 1;
+    job.letters = letters;
+    job.bannedWords = { "?AB:3" };
+    CHECK(validateJob(job).empty());
+    for (const char* bad : { "?AB:0", "?AB:x", "?AB:", "?:2" }) {
+        job.bannedWords = { bad };
+        CHECK(!validateJob(job).empty());
+    }
+}
+
+// The balanced fill gives every letter close to an equal share of the grid,
+// still forming no banned word, and reports the spread it reached
+void testBalancedFillEvensOutLetters() {
+    const std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    auto spreadOf = [&](const WordSearch& ws, int rows, int cols) {
+        std::map<char, int> counts;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                ++counts[ws.cell(r, c)];
+            }
+        }
+        int most = 0, fewest = rows * cols;
+        for (char letter : letters) {
+            most = std::max(most, counts[letter]);
+            fewest = std::min(fewest, counts[letter]);
+        }
+        return most - fewest;
+    };
+
+    WordSearch exact(21, 19, { "ABBA", "CAD" }, letters, {}, 98);
+    exact.setFillMode(FillMode::Balanced);
+    exact.setLetterTolerance(0);
+    CHECK(exact.generate());
+    CHECK(exact.stats().quotaOverruns == 0);
+    CHECK(exact.stats().letterSpread == spreadOf(exact, 21, 19));
+    CHECK(exact.stats().letterSpread <= 3);
+
+    const std::unordered_set<std::string> banned = { "AABD", "DCD", "BDA", "CCA" };
+    WordSearch unbalanced(30, 30, {}, letters, banned, 98);
+    unbalanced.generate();
+    for (int tolerance : { 1, 3 }) {
+        WordSearch balanced(30, 30, {}, letters, banned, 98);
+        balanced.setFillMode(FillMode::Balanced);
+        balanced.setLetterTolerance(tolerance);
+        CHECK(balanced.generate());
+        CHECK(!balanced.referenceContainsBannedWords());
+        CHECK(balanced.stats().letterSpread == spreadOf(balanced, 30, 30));
+        CHECK(balanced.stats().letterSpread <= 3 + tolerance);
+        CHECK(balanced.stats().letterSpread < spreadOf(unbalanced, 30, 30));
+    }
+
+    // With no letters at all every cell is left empty and counted
+    WordSearch empty(4, 5, std::vector<std::string>(), std::vector<char>(), banned, 1);
+    empty.setFillMode(FillMode::Balanced);
+    CHECK(!empty.fillGrid());
+    CHECK(empty.stats().unfilledCells == 20);
+}
+
+// Shadow grids only change where the scans read from: every fill gives the
+// same puzzle after the same checks with them as without
+void testShadowGridsDoNotChangeThePuzzle() {
+    const std::vector<std::string> words = { "ABBA", "CAD", "DAD", "BCDA", "ACDC" };
+    const std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    const std::unordered_set<std::string> banned = { "ABCA", "CBAB", "~BACD", "?DDA:2" };
+    for (FillMode mode : { FillMode::Rejection, FillMode::Repair, FillMode::Tiles, FillMode::Balanced }) {
+        for (int threads : { 0, 2 }) {
+            std::string grids[2];
+            std::uint64_t checks[2];
+            for (int shadowed = 0; shadowed < 2; ++shadowed) {
+                WordSearch ws(37, 29, words, letters, banned, 99);
+                ws.setShadowGrids(shadowed == 1);
+                ws.setFillMode(mode);
+                ws.setFillThreads(threads);
+                ws.generate();
+                std::ostringstream grid;
+                ws.printGrid(grid);
+                grids[shadowed] = grid.str();
+                checks[shadowed] = ws.stats().bannedChecks;
+            }
+            CHECK(grids[0] == grids[1]);
+            CHECK(checks[0] == checks[1]);
+        }
+    }
+}
+
+// On a wrap-around grid words run across the edges, and so do the banned
+// words the fill keeps out
+void testWrapAroundGrids() {
+    const std::vector<std::string> words = { "ABBA", "CAD", "DAD", "BCDA", "ACDC", "DCBA", "BAD" };
+    const std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    const std::unordered_set<std::string> banned = { "ABCA", "CBAB", "~BACD", "?DDA:2" };
+
+    // A banned word met only across the edge
+    WordSearch edge(3, 4, {}, letters, { "AB" }, 1);
+    edge.setGrid({ "BCCA", "CCCC", "CCCC" });
+    CHECK(!edge.bannedWordAnywhere());
+    CHECK(edge.setWrapAround(true));
+    CHECK(edge.bannedWordAnywhere() && edge.bannedWordAt(0, 0) && edge.bannedWordAt(0, 3) && !edge.bannedWordAt(0, 1));
+    CHECK(edge.referenceContainsBannedWords());
+
+    // More columns and diagonals than are gathered in one block: a banned
+    // word written anywhere, in any direction, is found, and a near miss is not
+    std::mt19937 rng(100);
+    for (int iteration = 0; iteration < 40; ++iteration) {
+        std::vector<std::string> lines(70, std::string(140, 'D'));
+        int r = rng() % 70, c = rng() % 140;
+        const auto& direction = placementDirections[rng() % placementDirectionCount];
+        std::string written = iteration % 2 == 0 ? "ABC" : "ACB";
+        for (int k = 0; k < 3; ++k) {
+            lines[(r + direction.first * k + 70) % 70][(c + direction.second * k + 140) % 140] = written[k];
+        }
+        WordSearch wide(70, 140, {}, letters, { "ABC" }, 1);
+        CHECK(wide.setWrapAround(true));
+        wide.setGrid(lines);
+        CHECK(wide.bannedWordAnywhere() == (iteration % 2 == 0));
+        CHECK(wide.referenceContainsBannedWords() == (iteration % 2 == 0));
+    }
+
+    int crossing = 0;
+    for (FillMode mode : { FillMode::Rejection, FillMode::Repair, FillMode::Tiles, FillMode::Balanced }) {
+        for (unsigned seed = 1; seed <= 5; ++seed) {
+            WordSearch ws(6, 7, words, letters, banned, seed);
+            CHECK(ws.setWrapAround(true));
+            ws.setFillMode(mode);
+            ws.setFillThreads(2); // Ignored: a wrap-around grid fills in one pass
+            bool filled = ws.generate();
+            CHECK(filled == (ws.stats().unfilledCells == 0));
+
+            std::vector<std::vector<bool>> placed(6, std::vector<bool>(7, false));
+            for (const auto& placement : ws.placements()) {
+                const std::string& word = ws.word(placement);
+                int endRow = placement.row + placement.dr * (static_cast<int>(word.size()) - 1);
+                int endCol = placement.col + placement.dc * (static_cast<int>(word.size()) - 1);
+                crossing += endRow < 0 || endRow >= 6 || endCol < 0 || endCol >= 7;
+                for (int k = 0; k < static_cast<int>(word.size()); ++k) {
+                    int r = (placement.row + placement.dr * k + 6) % 6;
+                    int c = (placement.col + placement.dc * k + 7) % 7;
+                    CHECK(ws.cell(r, c) == word[k]);
+                    placed[r][c] = true;
+                }
+            }
+            for (int r = 0; r < 6; ++r) {
+                for (int c = 0; c < 7; ++c) {
+                    CHECK(placed[r][c] || ws.cell(r, c) == ' ' || !ws.referenceBannedWordAt(r, c));
+                }
+            }
+            CHECK(ws.discouragedPenaltyAnywhere() == ws.referenceDiscouragedPenalty());
+        }
+    }
+    CHECK(crossing > 0);
+
+    // Every word and banned word has to fit the shorter side
+    WordSearch narrow(3, 7, words, letters, banned, 1);
+    CHECK(!narrow.setWrapAround(true));
+    PuzzleJob job;
+    job.numPuzzles = 1;
+    job.rows = 6;
+    job.cols = 7;
+    job.words = words;
+    job.letters = letters;
+    job.bannedWords = banned;
+    job.wrapAround = true;
+    CHECK(validateJob(job).empty());
+    job.bannedWords.insert("~ABCDEF"); // Near-spellings seven letters long
+    CHECK(!validateJob(job).empty());
+}
+
+// Variants keep every placed word where it is and refill the rest, and a
+// puzzle read back from its output can be refilled the same way
+void testVariantsKeepThePlacement() {
+    const std::vector<std::string> words = { "ABBA", "CAD", "DAD", "BCDA", "ACDC" };
+    const std::vector<char> letters = { 'A', 'B', 'C', 'D' };
+    const std::unordered_set<std::string> banned = { "ABCA", "CBAB" };
+    auto wordsInPlace = [](const WordSearch& ws, const WordSearch& original) {
+        for (const auto& placement : original.placements()) {
+            const std::string& word = original.word(placement);
+            for (int k = 0; k < static_cast<int>(word.size()); ++k) {
+                if (ws.cell(placement.row + placement.dr * k, placement.col + placement.dc * k) != word[k]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    auto noBannedWordFilled = [](const WordSearch& ws, const WordSearch& original) {
+        std::vector<std::vector<bool>> placed(12, std::vector<bool>(10, false));
+        for (const auto& placement : original.placements()) {
+            for (int k = 0; k < static_cast<int>(original.word(placement).size()); ++k) {
+                placed[placement.row + placement.dr * k][placement.col + placement.dc * k] = true;
+            }
+        }
+        for (int r = 0; r < 12; ++r) {
+            for (int c = 0; c < 10; ++c) {
+                if (!placed[r][c] && ws.referenceBannedWordAt(r, c)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    auto lines = [](const WordSearch& ws) {
+        std::ostringstream text;
+        ws.printGrid(text);
+        std::vector<std::string> result;
+        std::istringstream in(text.str());
+        for (std::string line; std::getline(in, line);) {
+            result.push_back(line);
+        }
+        return result;
+    };
+
+    WordSearch original(12, 10, words, letters, banned, 95);
+    CHECK(original.generate());
+    CHECK(!original.placements().empty());
+    WordSearch variant = original.variant(96);
+    CHECK(variant.fillGrid());
+    CHECK(wordsInPlace(variant, original));
+    CHECK(noBannedWordFilled(variant, original));
+    CHECK(lines(variant) != lines(original));
+    CHECK(variant.stats().wordsPlaced == original.stats().wordsPlaced && variant.stats().placementProbes == 0);
+    WordSearch again = original.variant(96);
+    CHECK(lines(again) != lines(variant) && wordsInPlace(again, original)); // Empty around the words until filled
+    again.fillGrid();
+    CHECK(lines(again) == lines(variant));
+
+    WordSearch restored = original; // Still knows where its words went
+    restored.setGrid(lines(original));
+    CHECK(restored.restorePlacements() == original.stats().wordsPlaced);
+    CHECK(restored.placements().size() == original.placements().size());
+    CHECK(restored.fillGrid());
+    CHECK(wordsInPlace(restored, original));
+    CHECK(noBannedWordFilled(restored, original));
+
+    // Without the original placements one occurrence of each word is kept,
+    // and words the fill spelled by chance are filled again
+    WordSearch archived(12, 10, words, letters, banned, 97);
+    archived.setGrid(lines(original));
+    CHECK(archived.restorePlacements() == original.stats().wordsPlaced);
+    CHECK(archived.placements().size() == static_cast<std::size_t>(original.stats().wordsPlaced));
+    CHECK(archived.fillGrid());
+    CHECK(noBannedWordFilled(archived, archived));
+    std::vector<std::vector<bool>> kept(12, std::vector<bool>(10, false));
+    for (const auto& placement : archived.placements()) {
+        for (int k = 0; k < static_cast<int>(archived.word(placement).size()); ++k) {
+            kept[placement.row + placement.dr * k][placement.col + placement.dc * k] = true;
+        }
+    }
+    int fillCells = 0, changed = 0;
+    for (int r = 0; r < 12; ++r) {
+        for (int c = 0; c < 10; ++c) {
+            if (!kept[r][c]) {
+                ++fillCells;
+                changed += archived.cell(r, c) != original.cell(r, c);
+            }
+        }
+    }
+    CHECK(2 * changed > fillCells);
+
+    // A job's first variant is the puzzle it writes without variants
+    PuzzleJob job;
+    job.rows = 12;
+    job.cols = 10;
+    job.words = words;
+    job.letters = letters;
+    job.bannedWords = banned;
+    job.numPuzzles = 3;
+    job.seed = 95;
+    job.numThreads = 2;
+    job.outputFile = "test_variants_one.txt";
+    generatePuzzles(job);
+    job.variants = 3;
+    job.outputFile = "test_variants_three.txt";
+    generatePuzzles(job);
+    std::vector<std::vector<std::string>> one, three;
+    std::string error;
+    std::ifstream oneFile("test_variants_one.txt"), threeFile("test_variants_three.txt");
+    CHECK(readArchive(oneFile, one, error) && readArchive(threeFile, three, error));
+    CHECK(one.size() == 3 && three.size() == 9);
+    for (std::size_t i = 0; i < one.size() && three.size() == 9; ++i) {
+        CHECK(three[3 * i] == one[i]);
+        CHECK(three[3 * i + 1] != one[i]);
+    }
+    CHECK(readFile("test_variants_three.txt").find("Puzzle 2 variant 3:") != std::string::npos);
+
+    // Refilling the archive keeps each puzzle's words
+    job.variants = 1;
+    job.archive = one;
+    job.seed = 98;
+    job.outputFile = "test_variants_refill.txt";
+    generatePuzzles(job);
+    std::vector<std::vector<std::string>> refilled;
+    std::ifstream refillFile("test_variants_refill.txt");
+    CHECK(readArchive(refillFile, refilled, error) && refilled.size() == 3);
+    for (std::size_t i = 0; i < refilled.size() && i < one.size(); ++i) {
+        WordSearch before(12, 10, words, letters, banned, 1);
+        before.setGrid(one[i]);
+        before.restorePlacements();
+        WordSearch after(12, 10, words, letters, banned, 1);
+        after.setGrid(refilled[i]);
+        CHECK(wordsInPlace(after, before));
+        CHECK(refilled[i] != one[i]);
+    }
+    job.numPuzzles = 4;
+    CHECK(!validateJob(job).empty()); // More puzzles than the archive holds
+    std::remove("test_variants_one.txt");
+    std::remove("test_variants_three.txt");
+    std::remove("test_variants_refill.txt");
+}
+
+int main() {
+    currentLogLevel = LogLevel::ERROR;
+
+    testLatencyHistogramPercentiles();
+    testHotPathDoesNotAllocate();
+    testMatcherBackendsAgreeWithReference();
+    testOutputIsDeterministicAcrossThreadsAndWriters();
+    testConcurrentJobsWithCancellation();
+    testPlacementFindsRareSlots();
+    testBitboardSlotsMatchReference();
+    testPuzzleDeadlines();
+    testRetryPolicy();
+    testRepairFillLeavesNoBannedWords();
+    testTileFillLeavesNoBannedWords();
+    testParallelFillIsDeterministic();
+    testFillSkipsImpossibleBannedWords();
+    testVariantsKeepThePlacement();
+    testFuzzyBannedWords();
+    testDiscouragedWordsAreAvoided();
+    testBalancedFillEvensOutLetters();
+    testShadowGridsDoNotChangeThePuzzle();
+    testWrapAroundGrids();
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed.\n";
+        return 1;
+    }
+    std::cout << "All tests passed.\n";
+    return 0;
+}
@@ -31,47 +31,2202 @@
 #include <future>
 #include <mutex>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <map>
+#include <csignal>
+#include <bitset>
+#include <cmath>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 // Log levels for controlling log output in production
 enum class LogLevel { DEBUG, INFO, WARN, ERROR };
 LogLevel currentLogLevel = LogLevel::INFO; // Set this to change log verbosity
 
-// Logging function that respects the log level
-void log(LogLevel level, const std::string& message) {
-    if (level >= currentLogLevel) {
-        std::string prefix;
-        switch (level) {
-            case LogLevel::DEBUG: prefix = "[DEBUG] "; break;
-            case LogLevel::INFO:  prefix = "[INFO] "; break;
-            case LogLevel::WARN:  prefix = "[WARN] "; break;
-            case LogLevel::ERROR: prefix = "[ERROR] "; break;
+// Whether messages at the given level are printed. Check this before building
+// an expensive message on a hot path.
+bool logEnabled(LogLevel level) {
+    return level >= currentLogLevel;
+}
+
+// Logging function that respects the log level. Workers log concurrently, so
+// each line is written whole under a lock to keep lines from interleaving.
+void log(LogLevel level, const char* message) {
+    if (logEnabled(level)) {
+        std::string line;
+        switch (level) {
+            case LogLevel::DEBUG: line = "[DEBUG] "; break;
+            case LogLevel::INFO:  line = "[INFO] "; break;
+            case LogLevel::WARN:  line = "[WARN] "; break;
+            case LogLevel::ERROR: line = "[ERROR] "; break;
+        }
+        line += message;
+        line += '\n';
+        static std::mutex logMutex;
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << line << std::flush;
+    }
+}
+
+void log(LogLevel level, const std::string& message) {
+    log(level, message.c_str());
+}
+
+// Heap allocations made by one thread
+struct AllocationCounts {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+
+    AllocationCounts operator-(const AllocationCounts& start) const {
+        AllocationCounts delta;
+        delta.allocations = allocations - start.allocations;
+        delta.bytes = bytes - start.bytes;
+        return delta;
+    }
+
+    AllocationCounts& operator+=(const AllocationCounts& other) {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+#ifdef WORDSEARCH_COUNT_ALLOCATIONS
+// Benchmark builds replace the global allocation functions to count every
+// heap allocation made by each thread. This adds a thread-local update to
+// every new, so it is never compiled into regular builds.
+const bool allocationCountingEnabled = true;
+thread_local AllocationCounts threadAllocations;
+
+void* operator new(std::size_t size) {
+    ++threadAllocations.allocations;
+    threadAllocations.bytes += size;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++threadAllocations.allocations;
+    threadAllocations.bytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+// GCC cannot see that these pair with the malloc in the replaced new above
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+// Allocations made by the calling thread so far
+AllocationCounts currentThreadAllocations() {
+    return threadAllocations;
+}
+#else
+const bool allocationCountingEnabled = false;
+
+AllocationCounts currentThreadAllocations() {
+    return AllocationCounts();
+}
+#endif
+
+// High-dynamic-range latency histogram (values in microseconds). Buckets are
+// log-linear: each power of two is split into 32 linear sub-buckets, so every
+// recorded value is reported within ~3% of its true value from 1us up to hours,
+// without knowing the range in advance. Storage grows only as far as the
+// largest value recorded.
+class LatencyHistogram {
+public:
+    void record(std::uint64_t micros) {
+        std::size_t index = bucketIndex(micros);
+        if (index >= counts.size()) {
+            counts.resize(index + 1, 0);
+        }
+        ++counts[index];
+        ++total;
+        sumValue += micros;
+        maxValue = std::max(maxValue, micros);
+    }
+
+    // Add every sample recorded in another histogram to this one
+    void merge(const LatencyHistogram& other) {
+        if (other.counts.size() > counts.size()) {
+            counts.resize(other.counts.size(), 0);
+        }
+        for (std::size_t i = 0; i < other.counts.size(); ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sumValue += other.sumValue;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t sum() const { return sumValue; }
+    std::uint64_t max() const { return maxValue; }
+
+    // Number of samples whose bucket lies entirely at or below the given value
+    std::uint64_t countAtOrBelow(std::uint64_t micros) const {
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size() && bucketUpperBound(i) <= micros; ++i) {
+            seen += counts[i];
+        }
+        return seen;
+    }
+
+    // Smallest recorded value that at least `percent`% of samples are at or below
+    std::uint64_t percentile(double percent) const {
+        if (total == 0) {
+            return 0;
+        }
+        std::uint64_t rank = static_cast<std::uint64_t>(percent / 100.0 * total + 0.999999);
+        rank = std::max<std::uint64_t>(1, std::min(rank, total));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucketUpperBound(i), maxValue);
+            }
+        }
+        return maxValue;
+    }
+
+private:
+    static const int subBucketBits = 6; // 64 exact values, then 32 sub-buckets per power of two
+    static const std::uint64_t subBucketCount = 1ULL << subBucketBits;
+    static const std::uint64_t subBucketHalf = subBucketCount / 2;
+
+    std::vector<std::uint64_t> counts;
+    std::uint64_t total = 0;
+    std::uint64_t sumValue = 0;
+    std::uint64_t maxValue = 0;
+
+    static int highestBit(std::uint64_t value) {
+        int bit = 0;
+        while (value >>= 1) {
+            ++bit;
+        }
+        return bit;
+    }
+
+    static std::size_t bucketIndex(std::uint64_t value) {
+        if (value < subBucketCount) {
+            return static_cast<std::size_t>(value);
+        }
+        int exponent = highestBit(value);
+        int shift = exponent - subBucketBits + 1;
+        std::uint64_t top = value >> shift; // in [subBucketHalf, subBucketCount)
+        return static_cast<std::size_t>(subBucketCount + (exponent - subBucketBits) * subBucketHalf + (top - subBucketHalf));
+    }
+
+    // Highest value that maps to the given bucket
+    static std::uint64_t bucketUpperBound(std::size_t index) {
+        if (index < subBucketCount) {
+            return index;
+        }
+        std::uint64_t offset = index - subBucketCount;
+        int exponent = static_cast<int>(offset / subBucketHalf) + subBucketBits;
+        std::uint64_t top = offset % subBucketHalf + subBucketHalf;
+        int shift = exponent - subBucketBits + 1;
+        return (top << shift) + ((1ULL << shift) - 1);
+    }
+};
+
+// Phases of generating one puzzle that are timed separately
+enum class Phase { Placement, Fill, Write };
+const int phaseCount = 3;
+
+const char* phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Placement: return "placement";
+        case Phase::Fill:      return "fill";
+        case Phase::Write:     return "write";
+    }
+    return "unknown";
+}
+
+// Latency histograms for whole puzzles and for each phase
+struct LatencyReport {
+    LatencyHistogram puzzle;
+    LatencyHistogram phases[phaseCount];
+
+    LatencyHistogram& phase(Phase p) { return phases[static_cast<int>(p)]; }
+    const LatencyHistogram& phase(Phase p) const { return phases[static_cast<int>(p)]; }
+
+    void merge(const LatencyReport& other) {
+        puzzle.merge(other.puzzle);
+        for (int i = 0; i < phaseCount; ++i) {
+            phases[i].merge(other.phases[i]);
+        }
+    }
+};
+
+// Hardware events sampled around each phase when --perf-counters is given
+enum class HardwareEvent { Cycles, Instructions, CacheMisses, BranchMisses };
+const int hardwareEventCount = 4;
+
+const char* hardwareEventName(HardwareEvent event) {
+    switch (event) {
+        case HardwareEvent::Cycles:       return "cycles";
+        case HardwareEvent::Instructions: return "instructions";
+        case HardwareEvent::CacheMisses:  return "cache-misses";
+        case HardwareEvent::BranchMisses: return "branch-misses";
+    }
+    return "unknown";
+}
+
+bool perfCountersRequested = false; // Set by --perf-counters
+
+// Hardware performance counters for the calling thread, read through Linux
+// perf_event_open. Each event is opened on its own so that a kernel or VM
+// that lacks one event (or forbids all of them) simply reports fewer values.
+class PerfCounters {
+public:
+    PerfCounters() {
+        for (int i = 0; i < hardwareEventCount; ++i) {
+            fds[i] = -1;
+        }
+#ifdef __linux__
+        static const std::uint64_t configs[hardwareEventCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+        int lastError = 0;
+        for (int i = 0; i < hardwareEventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.exclude_kernel = 1; // Allowed at the default perf_event_paranoid level
+            attr.exclude_hv = 1;
+            fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds[i] < 0) {
+                lastError = errno;
+            }
+        }
+        if (availableMask() == 0) {
+            warnUnavailable(std::strerror(lastError));
+        }
+#else
+        warnUnavailable("not supported on this platform");
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int i = 0; i < hardwareEventCount; ++i) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Bit i is set when event i could be opened
+    unsigned availableMask() const {
+        unsigned mask = 0;
+        for (int i = 0; i < hardwareEventCount; ++i) {
+            if (fds[i] >= 0) {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+    }
+
+    // Read the running count of every available event (0 for the others)
+    void read(std::uint64_t values[hardwareEventCount]) const {
+        for (int i = 0; i < hardwareEventCount; ++i) {
+            values[i] = 0;
+#ifdef __linux__
+            if (fds[i] >= 0 && ::read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+                values[i] = 0;
+            }
+#endif
+        }
+    }
+
+private:
+    int fds[hardwareEventCount];
+
+    // Log once per run that counters are missing, then carry on without them
+    static void warnUnavailable(const char* reason) {
+        static std::atomic<bool> warned(false);
+        if (!warned.exchange(true)) {
+            log(LogLevel::WARN, std::string("Hardware performance counters unavailable (") + reason + "); continuing without them.");
+        }
+    }
+};
+
+// Hardware event totals per phase, for the events that could be read
+struct HardwareCounterTotals {
+    std::uint64_t values[phaseCount][hardwareEventCount] = {};
+    unsigned availableMask = 0;
+
+    void merge(const HardwareCounterTotals& other) {
+        for (int p = 0; p < phaseCount; ++p) {
+            for (int e = 0; e < hardwareEventCount; ++e) {
+                values[p][e] += other.values[p][e];
+            }
+        }
+        availableMask |= other.availableMask;
+    }
+
+    std::uint64_t value(Phase phase, HardwareEvent event) const {
+        return values[static_cast<int>(phase)][static_cast<int>(event)];
+    }
+
+    bool available(HardwareEvent event) const {
+        return (availableMask & (1u << static_cast<int>(event))) != 0;
+    }
+};
+
+// Microseconds elapsed since the given time point
+std::uint64_t microsSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+// Format a microsecond latency as milliseconds for reports
+std::string formatMillis(std::uint64_t micros) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3fms", micros / 1000.0);
+    return buffer;
+}
+
+// Summarize a histogram as "p50=... p90=... p99=... p99.9=... max=..."
+std::string formatPercentiles(const LatencyHistogram& histogram) {
+    return "p50=" + formatMillis(histogram.percentile(50.0)) +
+           " p90=" + formatMillis(histogram.percentile(90.0)) +
+           " p99=" + formatMillis(histogram.percentile(99.0)) +
+           " p99.9=" + formatMillis(histogram.percentile(99.9)) +
+           " max=" + formatMillis(histogram.max()) +
+           " (n=" + std::to_string(histogram.count()) + ")";
+}
+
+// Aho-Corasick automaton over the banned words and their reverses, so one
+// forward pass over a line of the grid finds banned words read in either
+// direction. Scanning a line costs the same however many words are banned,
+// which lets the fill check only the lines through the cell it just wrote
+// instead of rescanning the whole grid for every word.
+//
+// A banned entry written as ~WORD also bans every spelling one substitution,
+// insertion or deletion away from WORD, using the letters of `alphabet` and
+// of the banned words. Those near-spellings go into the same automaton, so
+// they cost nothing extra per letter scanned; only the automaton grows.
+// Near-spellings shorter than fuzzyMinLength letters are not banned, or
+// ~CAT would ban every two-letter pair it shares with CT, CA and AT.
+//
+// An entry written as ?WORD or ?WORD:weight is only discouraged: it may
+// appear, but each occurrence costs its weight (1 if not given), which the
+// fills keep low. Discouraged words share the automaton too; each state
+// links to the longest discouraged word among its proper suffixes, so the
+// penalty through a cell costs a short walk along those links per letter.
+const int fuzzyMinLength = 3;
+const int maxDiscouragedWeight = 1000000;
+
+class BannedWordMatcher {
+public:
+    explicit BannedWordMatcher(const std::unordered_set<std::string>& bannedWords, const std::string& alphabet = std::string())
+        : symbolOf(256, -1) {
+        // Only near-spellings use letters outside the banned words
+        bool anyFuzzy = false;
+        std::string letters;
+        for (const auto& entry : bannedWords) {
+            anyFuzzy = anyFuzzy || isFuzzy(entry);
+            letters += wordOf(entry);
+        }
+        if (anyFuzzy) {
+            letters += alphabet;
+        }
+        for (char letter : letters) {
+            int& symbol = symbolOf[static_cast<unsigned char>(letter)];
+            if (symbol < 0) {
+                symbol = symbolCount++;
+                alphabetLetters.push_back(letter);
+            }
+        }
+
+        std::unordered_set<std::string> patterns;
+        std::map<std::string, int> weights; // Discouraged spelling -> summed weight
+        for (const auto& entry : bannedWords) {
+            std::string word;
+            int weight;
+            if (isDiscouraged(entry, word, weight)) {
+                if (weight > 0) {
+                    // A palindrome reads the same both ways, so counts once
+                    weights[word] += weight;
+                    std::string reversed(word.rbegin(), word.rend());
+                    if (reversed != word) {
+                        weights[reversed] += weight;
+                    }
+                    spellings.push_back(spellingOf(word, false));
+                }
+                continue;
+            }
+            if (!isFuzzy(entry)) {
+                if (!entry.empty()) {
+                    patterns.insert(entry);
+                    spellings.push_back(spellingOf(entry, false));
+                }
+                continue;
+            }
+            word = entry.substr(1);
+            patterns.insert(word);
+            addNearSpellings(word, patterns);
+            spellings.push_back(spellingOf(word, true));
+        }
+
+        newState(); // Root
+        for (const auto& pattern : patterns) {
+            addPattern(pattern);
+            addPattern(std::string(pattern.rbegin(), pattern.rend()));
+            longestPattern = std::max(longestPattern, static_cast<int>(pattern.length()));
+        }
+        anyDiscouraged = !weights.empty();
+        for (const auto& spelling : weights) {
+            int state = addSpelling(spelling.first);
+            weightOf[state] = spelling.second;
+            longestPattern = std::max(longestPattern, static_cast<int>(spelling.first.length()));
+        }
+        buildFailureLinks();
+    }
+
+    static bool isDiscouraged(const std::string& entry) { return entry.size() > 1 && entry[0] == '?'; }
+
+    // Whether a banned entry is a discouraged word, ?WORD or ?WORD:weight,
+    // and if so its word and weight; a malformed weight reads as 0
+    static bool isDiscouraged(const std::string& entry, std::string& word, int& weight) {
+        if (!isDiscouraged(entry)) {
+            return false;
+        }
+        std::size_t colon = entry.find(':');
+        word = entry.substr(1, colon == std::string::npos ? std::string::npos : colon - 1);
+        weight = colon == std::string::npos ? 1 : 0;
+        if (colon != std::string::npos) {
+            std::string digits = entry.substr(colon + 1);
+            if (!digits.empty() && digits.size() <= 7 && digits.find_first_not_of("0123456789") == std::string::npos) {
+                weight = std::atoi(digits.c_str());
+            }
+            weight = weight <= maxDiscouragedWeight ? weight : 0;
+        }
+        if (word.empty()) {
+            weight = 0;
+        }
+        return true;
+    }
+
+    // The word a banned entry spells, without its ~ or ? and weight
+    static std::string wordOf(const std::string& entry) {
+        std::string word;
+        int weight;
+        if (isDiscouraged(entry, word, weight)) {
+            return word;
+        }
+        return entry.substr(isFuzzy(entry) ? 1 : 0);
+    }
+
+    // Whether a banned entry also bans near-spellings of its word
+    static bool isFuzzy(const std::string& entry) { return entry.size() > 1 && entry[0] == '~'; }
+
+    bool empty() const { return longestPattern == 0; }
+
+    bool hasDiscouragedWords() const { return anyDiscouraged; }
+
+    // Length of the longest banned word
+    int maxLength() const { return longestPattern; }
+
+    // Whether letter can be part of a banned spelling
+    bool inAlphabet(char letter) const { return symbolOf[static_cast<unsigned char>(letter)] >= 0; }
+
+    // Whether a banned word could run through a cell filled with one of
+    // fillLetters, in a grid whose other cells hold only fillLetters and
+    // gridLetters and whose lines are at most longestLine cells long
+    bool canOccur(const std::bitset<256>& fillLetters, const std::bitset<256>& gridLetters, int longestLine) const {
+        std::bitset<256> allowed = fillLetters | gridLetters;
+        for (const auto& spelling : spellings) {
+            if (spelling.fuzzy) {
+                // A near-spelling can swap one letter for a fill letter, so
+                // allow for any that needs at most one letter changed
+                int shortest = std::min(spelling.length, std::max(fuzzyMinLength, spelling.length - 1));
+                if (shortest <= longestLine && (spelling.letters & ~allowed).count() <= 1) {
+                    return true;
+                }
+            } else if (spelling.length <= longestLine && (spelling.letters & ~allowed).none() &&
+                       (spelling.letters & fillLetters).any()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Whether a banned word occurs anywhere in line[0, length)
+    bool occursIn(const char* line, int length) const {
+        int state = 0;
+        for (int j = 0; j < length; ++j) {
+            state = step(state, line[j]);
+            if (longestMatch[state] > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Whether a banned word occurs in line[0, length) covering position center
+    bool occursThrough(const char* line, int length, int center) const {
+        int end = std::min(length, center + longestPattern);
+        int state = 0;
+        for (int j = 0; j < end; ++j) {
+            state = step(state, line[j]);
+            // The longest match ending here is the one most likely to reach back to center
+            if (j >= center && longestMatch[state] >= j - center + 1) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Call visit(end, matchLength, weight) for every discouraged word ending
+    // at a position end >= from of line[0, length), longest first at each
+    template <typename Visit>
+    void forEachDiscouragedMatch(const char* line, int length, int from, Visit visit) const {
+        int state = 0;
+        for (int j = 0; j < length; ++j) {
+            state = step(state, line[j]);
+            if (j < from) {
+                continue;
+            }
+            for (int match = weightOf[state] > 0 ? state : discouragedLink[state]; match > 0; match = discouragedLink[match]) {
+                visit(j, depth[match], weightOf[match]);
+            }
+        }
+    }
+
+    // Summed weight of the discouraged words in line[0, length) covering
+    // position center
+    std::uint64_t penaltyThrough(const char* line, int length, int center) const {
+        std::uint64_t penalty = 0;
+        forEachDiscouragedMatch(line, std::min(length, center + longestPattern), center, [&](int end, int matchLength, int weight) {
+            if (end - matchLength < center) {
+                penalty += weight;
+            }
+        });
+        return penalty;
+    }
+
+    // Call visit(end, matchLength) with the longest banned word ending at each
+    // position end >= from of line[0, length), wherever one ends. Positions
+    // before `from` only provide context.
+    template <typename Visit>
+    void forEachLongestMatch(const char* line, int length, int from, Visit visit) const {
+        int state = 0;
+        for (int j = 0; j < length; ++j) {
+            state = step(state, line[j]);
+            if (j >= from && longestMatch[state] > 0) {
+                visit(j, longestMatch[state]);
+            }
+        }
+    }
+
+private:
+    std::vector<int> symbolOf;     // Letter -> symbol, -1 for letters in no banned word
+    int symbolCount = 0;
+    std::vector<int> transitions;  // state * symbolCount + symbol -> next state
+    std::vector<int> longestMatch; // Longest banned word that is a suffix of the state, 0 if none
+    std::vector<int> depth;        // Letters spelled on the way to the state
+    std::vector<int> weightOf;     // Weight of the discouraged word the state spells, 0 if none
+    std::vector<int> discouragedLink; // Longest proper suffix spelling a discouraged word, 0 if none
+    bool anyDiscouraged = false;
+    int longestPattern = 0;
+
+    std::string alphabetLetters;   // Letters near-spellings may use
+
+    struct WordLetters {
+        int length;
+        std::bitset<256> letters;
+        bool fuzzy;
+    };
+    std::vector<WordLetters> spellings; // Length and letters of each banned word
+
+    static WordLetters spellingOf(const std::string& word, bool fuzzy) {
+        WordLetters spelling;
+        spelling.length = static_cast<int>(word.length());
+        spelling.fuzzy = fuzzy;
+        for (char letter : word) {
+            spelling.letters[static_cast<unsigned char>(letter)] = true;
+        }
+        return spelling;
+    }
+
+    // Every spelling one edit away from word, at least fuzzyMinLength long
+    void addNearSpellings(const std::string& word, std::unordered_set<std::string>& patterns) const {
+        std::size_t n = word.size();
+        for (std::size_t i = 0; i <= n; ++i) {
+            if (i < n && n - 1 >= static_cast<std::size_t>(fuzzyMinLength)) {
+                patterns.insert(word.substr(0, i) + word.substr(i + 1)); // Deletion
+            }
+            for (char letter : alphabetLetters) {
+                if (n + 1 >= static_cast<std::size_t>(fuzzyMinLength)) {
+                    patterns.insert(word.substr(0, i) + letter + word.substr(i)); // Insertion
+                }
+                if (i < n && n >= static_cast<std::size_t>(fuzzyMinLength)) {
+                    std::string substituted = word;
+                    substituted[i] = letter;
+                    patterns.insert(substituted);
+                }
+            }
+        }
+    }
+
+    int newState() {
+        transitions.resize(transitions.size() + symbolCount, -1);
+        longestMatch.push_back(0);
+        depth.push_back(0);
+        weightOf.push_back(0);
+        discouragedLink.push_back(0);
+        return static_cast<int>(longestMatch.size()) - 1;
+    }
+
+    int step(int state, char letter) const {
+        int symbol = symbolOf[static_cast<unsigned char>(letter)];
+        return symbol < 0 ? 0 : transitions[state * symbolCount + symbol];
+    }
+
+    void addPattern(const std::string& pattern) {
+        longestMatch[addSpelling(pattern)] = static_cast<int>(pattern.length());
+    }
+
+    // Add the states spelling `spelling` to the trie; returns the last
+    int addSpelling(const std::string& spelling) {
+        int state = 0;
+        for (char letter : spelling) {
+            int index = state * symbolCount + symbolOf[static_cast<unsigned char>(letter)];
+            if (transitions[index] < 0) {
+                int next = newState();
+                depth[next] = depth[state] + 1;
+                transitions[index] = next;
+            }
+            state = transitions[index];
+        }
+        return state;
+    }
+
+    // Turn the trie into a complete automaton: missing transitions follow the
+    // failure links, and each state inherits the matches of its failure state
+    void buildFailureLinks() {
+        std::vector<int> failure(longestMatch.size(), 0);
+        std::vector<int> queue;
+        for (int symbol = 0; symbol < symbolCount; ++symbol) {
+            int& child = transitions[symbol];
+            if (child < 0) {
+                child = 0;
+            } else {
+                queue.push_back(child);
+            }
+        }
+        for (std::size_t head = 0; head < queue.size(); ++head) {
+            int state = queue[head];
+            for (int symbol = 0; symbol < symbolCount; ++symbol) {
+                int fallback = transitions[failure[state] * symbolCount + symbol];
+                int& child = transitions[state * symbolCount + symbol];
+                if (child < 0) {
+                    child = fallback;
+                } else {
+                    failure[child] = fallback;
+                    longestMatch[child] = std::max(longestMatch[child], longestMatch[fallback]);
+                    discouragedLink[child] = weightOf[fallback] > 0 ? fallback : discouragedLink[fallback];
+                    queue.push_back(child);
+                }
+            }
+        }
+    }
+};
+
+// Directions words are placed in
+const std::pair<int, int> placementDirections[] = { {0, 1}, {1, 0}, {1, 1}, {0, -1}, {-1, 0}, {-1, -1} };
+const int placementDirectionCount = 6;
+
+// Start cells of a word that stay inside the grid: a rectangle, half-open
+struct SlotRect {
+    int rowBegin = 0, rowEnd = 0;
+    int colBegin = 0, colEnd = 0;
+
+    int count() const { return std::max(0, rowEnd - rowBegin) * std::max(0, colEnd - colBegin); }
+};
+
+// The in-bounds start cells for a word of each length in each placement
+// direction. They depend only on the grid size, so a job computes the table
+// once and shares it between its puzzles, and placement never has to
+// bounds-check a word.
+class SlotTable {
+public:
+    SlotTable(int rows, int cols, int maxLength) : rows(rows), cols(cols), longest(std::max(1, maxLength)) {
+        rects.resize(longest * placementDirectionCount);
+        totals.resize(longest, 0);
+        for (int length = 1; length <= longest; ++length) {
+            for (int d = 0; d < placementDirectionCount; ++d) {
+                int dr = placementDirections[d].first;
+                int dc = placementDirections[d].second;
+                SlotRect& rect = rects[(length - 1) * placementDirectionCount + d];
+                rect.rowBegin = dr < 0 ? -dr * (length - 1) : 0;
+                rect.rowEnd = dr > 0 ? rows - dr * (length - 1) : rows;
+                rect.colBegin = dc < 0 ? -dc * (length - 1) : 0;
+                rect.colEnd = dc > 0 ? cols - dc * (length - 1) : cols;
+                totals[length - 1] += rect.count();
+            }
+        }
+    }
+
+    // Whether this table is for the given grid and covers words this long
+    bool covers(int rows, int cols, int maxLength) const {
+        return this->rows == rows && this->cols == cols && longest >= maxLength;
+    }
+
+    // Slots for a word of the given length in one direction, and in all of them.
+    // Words longer than the table was built for fit nowhere.
+    const SlotRect& slots(int length, int direction) const {
+        static const SlotRect none;
+        return length <= longest ? rects[(length - 1) * placementDirectionCount + direction] : none;
+    }
+
+    int slotCount(int length) const { return length <= longest ? totals[length - 1] : 0; }
+
+    // The index-th slot for a word of the given length, counting through the
+    // directions in order and each rectangle row by row
+    void slot(int length, int index, int& direction, int& row, int& col) const {
+        for (direction = 0; direction < placementDirectionCount; ++direction) {
+            const SlotRect& rect = slots(length, direction);
+            int count = rect.count();
+            if (index < count) {
+                int width = rect.colEnd - rect.colBegin;
+                row = rect.rowBegin + index / width;
+                col = rect.colBegin + index % width;
+                return;
+            }
+            index -= count;
+        }
+    }
+
+private:
+    int rows, cols;
+    int longest;
+    std::vector<SlotRect> rects; // By length, then direction
+    std::vector<int> totals;     // Slots by length, over all directions
+};
+
+// Index of the lowest set bit; bits must not be 0
+inline int lowestBit(std::uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Number of set bits
+inline int bitCount(std::uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Bitboards of the letters placed in a grid: one bit per cell, each grid row
+// packed into 64-bit words. One board marks the occupied cells and there is
+// one more for each letter the words use, so where a word fits can be worked
+// out a whole row of start cells at a time with shifts and masks. Boards for
+// a wrap-around grid keep rows longer than one word twice over.
+class LetterBoards {
+public:
+    LetterBoards(int rows, int cols, const std::vector<std::string>& words, bool wrapAround = false)
+        : rows(rows), cols(cols), rowWords((cols + 63) / 64),
+          storedWords(wrapAround && rowWords > 1 ? 2 * rowWords : rowWords), occupied(rows * storedWords, 0), fits(rowWords, 0) {
+        std::fill(std::begin(boardOf), std::end(boardOf), -1);
+        int boardCount = 0;
+        for (const auto& word : words) {
+            for (char letter : word) {
+                int& board = boardOf[static_cast<unsigned char>(letter)];
+                if (board < 0) {
+                    board = boardCount++;
+                }
+            }
+        }
+        letterBits.assign(boardCount * rows * storedWords, 0);
+    }
+
+    void clear() {
+        std::fill(occupied.begin(), occupied.end(), 0);
+        std::fill(letterBits.begin(), letterBits.end(), 0);
+    }
+
+    // Record a letter written at (r, c), in both copies of a row stored twice
+    void set(int r, int c, char letter) {
+        setBit(r, c, letter);
+        if (storedWords > rowWords) {
+            setBit(r, c + cols, letter);
+        }
+    }
+
+    // Call visit(row, col, bits) with the starts in `rect` where the word
+    // fits read in direction (dr, dc), up to 64 of a row at a time: bit k is
+    // set if it fits at (row, col + k). Rows and columns come in order, until
+    // a visit returns true; returns whether one did. Each row of starts is found
+    // at once: for every letter of the word, shift the cells that are empty
+    // or hold that letter back to the start cells and intersect them. Words
+    // read backwards are matched as the reversed word read forwards.
+    template <typename Visit>
+    bool forEachFit(const std::string& word, int dr, int dc, const SlotRect& rect, Visit visit) {
+        int length = word.length();
+        bool reversed = dr < 0 || (dr == 0 && dc < 0);
+        int fr = reversed ? -dr : dr; // Forward direction
+        int fc = reversed ? -dc : dc;
+        // Forward starts are the far end of each backwards word
+        int rowOffset = reversed ? -fr * (length - 1) : 0;
+        int colOffset = reversed ? -fc * (length - 1) : 0;
+        int colBegin = rect.colBegin + colOffset;
+        int colEnd = rect.colEnd + colOffset;
+
+        for (int row = rect.rowBegin; row < rect.rowEnd; ++row) {
+            int start = row + rowOffset;
+            for (int w = 0; w < rowWords; ++w) {
+                fits[w] = rangeMask(w, colBegin, colEnd);
+            }
+            for (int i = 0; i < length && any(); ++i) {
+                char letter = word[reversed ? length - 1 - i : i];
+                for (int w = 0; w < rowWords; ++w) {
+                    fits[w] &= allowedShifted(letter, start + fr * i, w, fc * i);
+                }
+            }
+            for (int w = 0; w < rowWords; ++w) {
+                if (fits[w] != 0 && visit(row, w * 64 - colOffset, fits[w])) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // forEachFit() over every start of a wrap-around grid, whose lines run
+    // off one edge and back on at the opposite one: each letter's row is
+    // rotated back to the start cells rather than shifted. A row of one word
+    // is rotated in place; longer rows are stored twice over, so a shift
+    // brings the row's start round after its end. The boards must have been
+    // built for wrapping, and words must fit the grid's shorter side.
+    template <typename Visit>
+    bool forEachFitAround(const std::string& word, int dr, int dc, Visit visit) {
+        int length = word.length();
+        for (int row = 0; row < rows; ++row) {
+            if (rowWords == 1) {
+                std::uint64_t bits = rangeMask(0, 0, cols);
+                for (int i = 0; i < length && bits != 0; ++i) {
+                    int r = row + dr * i;
+                    r = r < 0 ? r + rows : r >= rows ? r - rows : r;
+                    int shift = dc * i < 0 ? dc * i + cols : dc * i;
+                    std::uint64_t cells = allowed(word[i], r, 0) & rangeMask(0, 0, cols);
+                    bits &= shift == 0 ? cells : (cells >> shift) | (cells << (cols - shift));
+                }
+                if (bits != 0 && visit(row, 0, bits)) {
+                    return true;
+                }
+                continue;
+            }
+            for (int w = 0; w < rowWords; ++w) {
+                fits[w] = rangeMask(w, 0, cols);
+            }
+            for (int i = 0; i < length && any(); ++i) {
+                int r = row + dr * i;
+                r = r < 0 ? r + rows : r >= rows ? r - rows : r;
+                int shift = dc * i < 0 ? dc * i + cols : dc * i;
+                // The row is stored twice, so every word read is in range
+                const std::uint64_t* taken = &occupied[r * storedWords + shift / 64];
+                int board = boardOf[static_cast<unsigned char>(word[i])];
+                const std::uint64_t* held = board >= 0 ? &letterBits[(board * rows + r) * storedWords + shift / 64] : nullptr;
+                int bits = shift % 64;
+                std::uint64_t low = ~taken[0] | (held ? held[0] : 0);
+                for (int w = 0; w < rowWords; ++w) {
+                    if (bits == 0) {
+                        fits[w] &= ~taken[w] | (held ? held[w] : 0);
+                        continue;
+                    }
+                    std::uint64_t high = ~taken[w + 1] | (held ? held[w + 1] : 0);
+                    fits[w] &= (low >> bits) | (high << (64 - bits));
+                    low = high;
+                }
+            }
+            for (int w = 0; w < rowWords; ++w) {
+                if (fits[w] != 0 && visit(row, w * 64, fits[w])) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    int rows, cols, rowWords;
+    int storedWords; // Words stored for each row: rowWords, or twice as many for the row twice over
+    int boardOf[256];                   // Board of each letter, -1 if no word uses it
+    std::vector<std::uint64_t> occupied;   // By row, then word within the row
+    std::vector<std::uint64_t> letterBits; // By board, then row, then word
+    std::vector<std::uint64_t> fits;       // Scratch: the start cells still possible in one row
+
+    bool any() const {
+        for (std::uint64_t bits : fits) {
+            if (bits != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Cells where the letter may go in word w of a row: empty, or holding it.
+    // Past the end of the row nothing may go.
+    std::uint64_t allowed(char letter, int r, int w) const {
+        if (w >= storedWords) {
+            return 0;
+        }
+        std::uint64_t bits = ~occupied[r * storedWords + w];
+        int board = boardOf[static_cast<unsigned char>(letter)];
+        if (board >= 0) {
+            bits |= letterBits[(board * rows + r) * storedWords + w];
+        }
+        return bits;
+    }
+
+    // allowed() moved `shift` cells towards the start of the row
+    std::uint64_t allowedShifted(char letter, int r, int w, int shift) const {
+        int skip = shift / 64;
+        int bits = shift % 64;
+        std::uint64_t low = allowed(letter, r, w + skip);
+        return bits == 0 ? low : (low >> bits) | (allowed(letter, r, w + skip + 1) << (64 - bits));
+    }
+
+    // set() for one column, which past the grid's width is in the copy
+    void setBit(int r, int c, char letter) {
+        std::uint64_t bit = std::uint64_t(1) << (c % 64);
+        occupied[r * storedWords + c / 64] |= bit;
+        int board = boardOf[static_cast<unsigned char>(letter)];
+        if (board >= 0) {
+            letterBits[(board * rows + r) * storedWords + c / 64] |= bit;
+        }
+    }
+
+    // Bits of word w that fall within columns [begin, end)
+    static std::uint64_t rangeMask(int w, int begin, int end) {
+        int low = std::max(begin - w * 64, 0);
+        int high = std::min(end - w * 64, 64);
+        if (low >= high) {
+            return 0;
+        }
+        std::uint64_t upTo = high == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << high) - 1;
+        return upTo & ~((std::uint64_t(1) << low) - 1);
+    }
+};
+
+// Length of the longest word
+int longestWord(const std::vector<std::string>& words) {
+    std::size_t longest = 0;
+    for (const auto& word : words) {
+        longest = std::max(longest, word.length());
+    }
+    return static_cast<int>(longest);
+}
+
+// Every letter the grid can hold: the fill letters and the letters of the
+// puzzle's words, each once. Near-spellings of ~ banned entries use these.
+std::string gridAlphabet(const std::vector<char>& letters, const std::vector<std::string>& words) {
+    std::bitset<256> seen;
+    std::string alphabet;
+    auto add = [&](char letter) {
+        if (!seen[static_cast<unsigned char>(letter)]) {
+            seen[static_cast<unsigned char>(letter)] = true;
+            alphabet += letter;
+        }
+    };
+    for (char letter : letters) {
+        add(letter);
+    }
+    for (const auto& word : words) {
+        for (char letter : word) {
+            add(letter);
+        }
+    }
+    return alphabet;
+}
+
+// Whether a and b are at most one substitution, insertion or deletion apart
+bool withinOneEdit(const std::string& a, const std::string& b) {
+    const std::string& shorter = a.size() <= b.size() ? a : b;
+    const std::string& longer = a.size() <= b.size() ? b : a;
+    if (longer.size() - shorter.size() > 1) {
+        return false;
+    }
+    std::size_t i = 0;
+    while (i < shorter.size() && shorter[i] == longer[i]) {
+        ++i;
+    }
+    // Past the first difference the rest must match, shifted by one if the lengths differ
+    std::size_t skip = longer.size() > shorter.size() ? 0 : 1;
+    return i == shorter.size() || shorter.compare(i + skip, std::string::npos, longer, i + 1, std::string::npos) == 0;
+}
+
+// Word length and fill level buckets for the placement success history
+const int placementLengthBuckets = 16;
+const int placementFillBuckets = 4;
+
+// Side, number and placement attempts of the tiles used by the tile fill
+const int tileSide = 8;
+const int tileLibrarySize = 128;
+const int tileAttempts = 8;
+
+// Square tiles of letters holding no banned word, with which tiles may sit
+// to the right of or below which without forming one across the seam. The
+// tiles depend only on the letters and banned words, so a job builds the
+// library once for all its puzzles, and it can be cached on disk between
+// runs. The same inputs always build the same library.
+class TileLibrary {
+public:
+    TileLibrary(const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords, const BannedWordMatcher& matcher)
+        : key(libraryKey(letters, bannedWords)) {
+        build(letters, matcher);
+    }
+
+    // The library for these letters and banned words, read from cacheDir if
+    // it was built there before, otherwise built and saved there. An empty
+    // cacheDir builds it without caching.
+    static std::shared_ptr<const TileLibrary> load(const std::string& cacheDir, const std::vector<char>& letters,
+                                                   const std::unordered_set<std::string>& bannedWords, const BannedWordMatcher& matcher) {
+        if (cacheDir.empty()) {
+            return std::make_shared<const TileLibrary>(letters, bannedWords, matcher);
+        }
+        std::string path = cachePath(cacheDir, letters, bannedWords);
+        std::shared_ptr<TileLibrary> library(new TileLibrary(libraryKey(letters, bannedWords)));
+        std::ifstream in(path);
+        if (in && library->read(in)) {
+            log(LogLevel::INFO, "Loaded " + std::to_string(library->count()) + " tiles from " + path + ".");
+            return library;
+        }
+        library = std::make_shared<TileLibrary>(letters, bannedWords, matcher);
+        library->save(path);
+        return library;
+    }
+
+    // Where load() caches the library for these letters and banned words
+    static std::string cachePath(const std::string& cacheDir, const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "tiles-%016llx.txt", static_cast<unsigned long long>(fnv1a(libraryKey(letters, bannedWords))));
+        return cacheDir + "/" + name;
+    }
+
+    int side() const { return tileSide; }
+    int count() const { return static_cast<int>(tiles.size()); }
+    char letter(int tile, int r, int c) const { return tiles[tile][r * tileSide + c]; }
+
+    // Whether tile b may sit to the right of tile a, or below it
+    bool fitsRightOf(int a, int b) const { return (rightOf[a][b / 64] >> (b % 64)) & 1; }
+    bool fitsBelow(int a, int b) const { return (below[a][b / 64] >> (b % 64)) & 1; }
+
+    // A random tile that may sit right of `left` and below `above` (-1 for
+    // no neighbour there), or -1 if none may
+    int pick(int left, int above, std::mt19937& rng) const {
+        std::uint64_t candidates[(tileLibrarySize + 63) / 64];
+        int words = (count() + 63) / 64;
+        int total = 0;
+        for (int w = 0; w < words; ++w) {
+            candidates[w] = w == words - 1 && count() % 64 != 0 ? (1ULL << (count() % 64)) - 1 : ~0ULL;
+            if (left >= 0) {
+                candidates[w] &= rightOf[left][w];
+            }
+            if (above >= 0) {
+                candidates[w] &= below[above][w];
+            }
+            total += bitCount(candidates[w]);
+        }
+        if (total == 0) {
+            return -1;
+        }
+        int index = std::uniform_int_distribution<int>(0, total - 1)(rng);
+        for (int w = 0;; ++w) {
+            int bits = bitCount(candidates[w]);
+            if (index < bits) {
+                std::uint64_t mask = candidates[w];
+                for (; index > 0; --index) {
+                    mask &= mask - 1;
+                }
+                return w * 64 + lowestBit(mask);
+            }
+            index -= bits;
+        }
+    }
+
+private:
+    explicit TileLibrary(const std::string& key) : key(key) {}
+
+    // Everything the tiles depend on, one line
+    static std::string libraryKey(const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords) {
+        std::vector<std::string> sorted(bannedWords.begin(), bannedWords.end());
+        std::sort(sorted.begin(), sorted.end());
+        std::string key = "side " + std::to_string(tileSide) + " count " + std::to_string(tileLibrarySize) + " letters ";
+        key.append(letters.begin(), letters.end());
+        key += " banned";
+        for (const auto& word : sorted) {
+            if (!word.empty()) {
+                key += " " + word;
+            }
+        }
+        return key;
+    }
+
+    static std::uint64_t fnv1a(const std::string& text) {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (char c : text) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Whether a banned word occurs in any row, column or diagonal of a
+    // height x width block of letters stored row by row
+    static bool blockHasBannedWord(const BannedWordMatcher& matcher, const std::string& block, int height, int width) {
+        char line[2 * tileSide];
+        auto scan = [&](int r, int c, int dr, int dc) {
+            int length = 0;
+            for (; r >= 0 && r < height && c >= 0 && c < width; r += dr, c += dc) {
+                line[length++] = block[r * width + c];
+            }
+            return matcher.occursIn(line, length);
+        };
+        for (int r = 0; r < height; ++r) {
+            if (scan(r, 0, 0, 1) || scan(r, 0, 1, 1) || scan(r, width - 1, 1, -1)) {
+                return true;
+            }
+        }
+        for (int c = 0; c < width; ++c) {
+            if (scan(0, c, 1, 0) || (c > 0 && scan(0, c, 1, 1)) || (c < width - 1 && scan(0, c, 1, -1))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Whether a banned word runs through cell i of a tile being drawn, whose
+    // later cells are still empty
+    static bool bannedWordThrough(const BannedWordMatcher& matcher, const std::string& tile, int i) {
+        static const std::pair<int, int> axes[] = { {0, 1}, {1, 0}, {1, 1}, {1, -1} };
+        char line[tileSide];
+        for (const auto& axis : axes) {
+            int r = i / tileSide;
+            int c = i % tileSide;
+            while (r - axis.first >= 0 && c - axis.second >= 0 && c - axis.second < tileSide) {
+                r -= axis.first;
+                c -= axis.second;
+            }
+            int length = 0;
+            for (; r < tileSide && c >= 0 && c < tileSide; r += axis.first, c += axis.second) {
+                line[length++] = tile[r * tileSide + c];
+            }
+            if (matcher.occursIn(line, length)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Draw distinct banned-free tiles cell by cell, seeded from the key, then
+    // work out which pairs may sit side by side. Both tiles of a pair are
+    // banned-free, so any banned word in the pair crosses the seam and lies
+    // within reach of it: only that strip of the pair is checked.
+    void build(const std::vector<char>& letters, const BannedWordMatcher& matcher) {
+        std::mt19937 rng(static_cast<std::uint32_t>(fnv1a(key)));
+        std::unordered_set<std::string> seen;
+        std::uniform_int_distribution<int> letterDist(0, std::max<int>(0, letters.size() - 1));
+        for (int attempt = 0; !letters.empty() && attempt < 8 * tileLibrarySize && count() < tileLibrarySize; ++attempt) {
+            std::string tile(tileSide * tileSide, ' ');
+            bool filled = true;
+            for (int i = 0; i < tileSide * tileSide && filled; ++i) {
+                int first = letterDist(rng);
+                filled = false;
+                for (std::size_t k = 0; k < letters.size() && !filled; ++k) {
+                    tile[i] = letters[(first + k) % letters.size()];
+                    filled = !bannedWordThrough(matcher, tile, i);
+                }
+            }
+            if (filled && seen.insert(tile).second) {
+                tiles.push_back(tile);
+            }
+        }
+
+        int words = (count() + 63) / 64;
+        rightOf.assign(count(), std::vector<std::uint64_t>(words, 0));
+        below.assign(count(), std::vector<std::uint64_t>(words, 0));
+        int reach = std::max(1, std::min(tileSide, matcher.maxLength() - 1));
+        std::string strip(2 * reach * tileSide, ' ');
+        for (int a = 0; a < count(); ++a) {
+            for (int b = 0; b < count(); ++b) {
+                for (int r = 0; r < tileSide; ++r) {
+                    std::copy_n(&tiles[a][r * tileSide + tileSide - reach], reach, &strip[r * 2 * reach]);
+                    std::copy_n(&tiles[b][r * tileSide], reach, &strip[r * 2 * reach + reach]);
+                }
+                if (!blockHasBannedWord(matcher, strip, tileSide, 2 * reach)) {
+                    rightOf[a][b / 64] |= 1ULL << (b % 64);
+                }
+                std::copy_n(&tiles[a][(tileSide - reach) * tileSide], reach * tileSide, &strip[0]);
+                std::copy_n(&tiles[b][0], reach * tileSide, &strip[reach * tileSide]);
+                if (!blockHasBannedWord(matcher, strip, 2 * reach, tileSide)) {
+                    below[a][b / 64] |= 1ULL << (b % 64);
+                }
+            }
+        }
+    }
+
+    // Cache file: a version line, the key, the tile count, then one line per
+    // tile with its letters and its right and below sets in hex
+    bool read(std::istream& in) {
+        std::string line;
+        if (!std::getline(in, line) || line != "wordsearch-tiles 1" || !std::getline(in, line) || line != key) {
+            return false;
+        }
+        int tileCount = 0;
+        if (!(in >> tileCount) || tileCount < 0 || tileCount > tileLibrarySize) {
+            return false;
+        }
+        int words = (tileCount + 63) / 64;
+        tiles.resize(tileCount);
+        rightOf.assign(tileCount, std::vector<std::uint64_t>(words, 0));
+        below.assign(tileCount, std::vector<std::uint64_t>(words, 0));
+        for (int t = 0; t < tileCount; ++t) {
+            std::string right, down;
+            if (!(in >> tiles[t] >> right >> down) || tiles[t].size() != static_cast<std::size_t>(tileSide * tileSide) ||
+                !parseHex(right, rightOf[t]) || !parseHex(down, below[t])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool parseHex(const std::string& text, std::vector<std::uint64_t>& words) {
+        if (text.size() != 16 * words.size()) {
+            return false;
+        }
+        for (std::size_t w = 0; w < words.size(); ++w) {
+            char* end = nullptr;
+            std::string chunk = text.substr(16 * w, 16);
+            words[w] = std::strtoull(chunk.c_str(), &end, 16);
+            if (*end != '\0') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Write through a temporary file, so a reader never sees half a library
+    void save(const std::string& path) const {
+        std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+        {
+            std::ofstream out(temporary);
+            out << "wordsearch-tiles 1\n" << key << "\n" << count() << "\n";
+            for (int t = 0; t < count(); ++t) {
+                out << tiles[t] << " ";
+                writeHex(out, rightOf[t]);
+                out << " ";
+                writeHex(out, below[t]);
+                out << "\n";
+            }
+            if (!out) {
+                log(LogLevel::WARN, "Could not write the tile cache " + temporary + ".");
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            log(LogLevel::WARN, "Could not save the tile cache to " + path + ": " + std::strerror(errno));
+            std::remove(temporary.c_str());
+        }
+    }
+
+    static void writeHex(std::ostream& out, const std::vector<std::uint64_t>& words) {
+        char hex[17];
+        for (std::uint64_t word : words) {
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(word));
+            out << hex;
+        }
+    }
+
+    std::string key;
+    std::vector<std::string> tiles;                 // Letters row by row
+    std::vector<std::vector<std::uint64_t>> rightOf; // Per tile, the tiles that may sit to its right
+    std::vector<std::vector<std::uint64_t>> below;   // Per tile, the tiles that may sit below it
+};
+
+// Smallest side of the blocks the rejection fill is split into when it runs
+// on several threads; larger blocks mean fewer generators to seed
+const int parallelFillBlockSide = 32;
+
+// How empty cells are filled. Rejection fills cells one at a time, drawing
+// letters until one forms no banned word. Repair fills every cell at once,
+// then changes letters in banned words until none are left, which leaves
+// far fewer cells empty when few letters are allowed and banned words are
+// common. Tiles covers empty blocks with tiles from a TileLibrary, checking
+// only the cells along their seams, and fills what is left by rejection.
+// Balanced fills cells one at a time like Rejection, but draws each from the
+// letters that form no banned word here, weighted by how far each is below
+// an equal share of the grid, so every letter ends up within a set
+// tolerance of the others.
+enum class FillMode { Rejection, Repair, Tiles, Balanced };
+
+// Counters describing the work done for one puzzle
+struct PuzzleStats {
+    int wordsPlaced = 0;
+    int wordsFailed = 0;
+    std::uint64_t fillRejections = 0; // Random letters rejected because they formed a banned word
+    std::uint64_t bannedChecks = 0;   // Checks for a banned word through a newly written cell
+    int unfilledCells = 0;            // Cells left empty: every letter formed a banned word, or time ran out
+    int wordsSkipped = 0;             // Words not tried because the deadline passed
+    std::uint64_t placementProbes = 0; // Random slots tried while placing words
+    std::uint64_t probeBudget = 0;     // Random probes allowed, summed over words
+    int slotScans = 0;                 // Words for which every slot was checked
+    std::uint64_t repairSteps = 0;     // Letters changed by the repair fill
+    int tilesPlaced = 0;               // Blocks covered by the tile fill
+    std::uint64_t discouragedPenalty = 0; // Weight of discouraged words through cells the rejection or repair fill wrote
+    int quotaOverruns = 0;             // Letters the balanced fill placed over their quota, as no other fitted
+    int letterSpread = 0;              // Balanced fill: most minus fewest cells holding any one fill letter
+    bool deadlineExceeded = false;
+};
+
+// How a puzzle turned out. A degraded puzzle is a valid puzzle that is
+// missing words because the deadline cut placement short; a failed one has
+// empty cells.
+enum class PuzzleResult { Complete, Degraded, Failed };
+
+const char* puzzleResultName(PuzzleResult result) {
+    switch (result) {
+        case PuzzleResult::Complete: return "complete";
+        case PuzzleResult::Degraded: return "degraded";
+        case PuzzleResult::Failed:   return "failed";
+    }
+    return "";
+}
+
+// Where a word was placed: its index in the puzzle's word list, its first
+// cell and its direction
+struct WordPlacement {
+    int word;
+    int row, col;
+    int dr, dc;
+};
+
+class WordSearch {
+public:
+    WordSearch(int rows, int cols, const std::vector<std::string>& words, const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords)
+        : WordSearch(rows, cols, words, letters, bannedWords, std::random_device{}()) {}
+
+    // The same seed and inputs always produce the same puzzle. Jobs pass in a
+    // matcher and slot table built once for all their puzzles; otherwise they
+    // are built here.
+    WordSearch(int rows, int cols, const std::vector<std::string>& words, const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords,
+               unsigned seed, std::shared_ptr<const BannedWordMatcher> matcher = nullptr, std::shared_ptr<const SlotTable> slotTable = nullptr)
+        : rows(rows), cols(cols), words(words), letters(letters), bannedWords(bannedWords), rng(seed),
+          matcher(matcher ? matcher : std::make_shared<const BannedWordMatcher>(bannedWords, gridAlphabet(letters, words))),
+          slotTable(slotTable && slotTable->covers(rows, cols, longestWord(words)) ? slotTable
+                                                                                   : std::make_shared<const SlotTable>(rows, cols, longestWord(words))),
+          boards(rows, cols, words) {
+        grid.resize(rows, std::vector<char>(cols, ' ')); // Initialize the grid with empty spaces
+        line.resize(std::max(1, 2 * this->matcher->maxLength() - 1));
+
+        // An empty word would be "placed" anywhere and an empty banned word
+        // found everywhere, so neither means anything
+        this->words.erase(std::remove(this->words.begin(), this->words.end(), std::string()), this->words.end());
+        this->bannedWords.erase(std::string());
+        placedWords.reserve(this->words.size());
+
+        for (char letter : letters) {
+            fillLetters[static_cast<unsigned char>(letter)] = true;
+        }
+        distinctLetters = static_cast<int>(fillLetters.count());
+        std::bitset<256> wordLetters;
+        for (const auto& word : this->words) {
+            for (char letter : word) {
+                wordLetters[static_cast<unsigned char>(letter)] = true;
+            }
+        }
+        updateFillChecks(wordLetters);
+        nearSpellingLetters = fillLetters | wordLetters;
+        for (const auto& entry : this->bannedWords) {
+            for (char letter : BannedWordMatcher::wordOf(entry)) {
+                nearSpellingLetters[static_cast<unsigned char>(letter)] = true;
+            }
+        }
+    }
+
+    // Generate the word search puzzle. Returns false if some cells had to be
+    // left empty because every letter would have formed a banned word.
+    bool generate() {
+        placeWords();
+
+        // Fill remaining empty cells with random letters
+        return fillGrid();
+    }
+
+    // Stop placing words once placementDeadline has passed, and filling cells
+    // once fillDeadline has. Placement stopping early leaves a valid puzzle
+    // with fewer words, so it gets the earlier deadline to leave time for the fill.
+    void setDeadlines(std::chrono::steady_clock::time_point placementDeadline, std::chrono::steady_clock::time_point fillDeadline) {
+        this->placementDeadline = placementDeadline;
+        this->fillDeadline = fillDeadline;
+        hasDeadline = true;
+    }
+
+    // Place the (non-banned) words in the grid in random order
+    void placeWords() {
+        log(LogLevel::DEBUG, "Shuffling words...");
+        std::shuffle(words.begin(), words.end(), rng); // Shuffle words for random placement
+        for (int i = 0; i < static_cast<int>(words.size()); ++i) {
+            if (hasDeadline && std::chrono::steady_clock::now() > placementDeadline) {
+                puzzleStats.deadlineExceeded = true;
+                puzzleStats.wordsSkipped = static_cast<int>(words.size()) - i;
+                break;
+            }
+            const std::string& word = words[i];
+            if (!isBanned(word)) {
+                if (logEnabled(LogLevel::DEBUG)) {
+                    log(LogLevel::DEBUG, "Placing word: " + word);
+                }
+                placeWord(word, i); // Place each word in the grid
+            } else if (logEnabled(LogLevel::DEBUG)) {
+                log(LogLevel::DEBUG, "Skipping banned word: " + word);
+            }
+        }
+    }
+
+    // The tile fill uses the given library, or builds one on first use
+    void setFillMode(FillMode mode, std::shared_ptr<const TileLibrary> tileLibrary = nullptr) {
+        fillMode = mode;
+        tiles = tileLibrary;
+    }
+
+    // Fill empty spaces in the grid with random letters that form no banned
+    // word. Returns false if some cell could not take any letter, or the
+    // deadline passed first; those cells are left empty.
+    bool fillGrid() {
+        log(LogLevel::DEBUG, "Filling the grid...");
+        if (fillMode == FillMode::Balanced) {
+            return fillBalanced(); // Balances the letters even with nothing to check
+        }
+        if (!fillNeedsChecks) {
+            return fillWithoutChecks();
+        }
+        // The repair and tile fills work on the rectangle; a wrap-around
+        // grid fills by rejection
+        switch (wrapAround ? FillMode::Rejection : fillMode) {
+        case FillMode::Repair:
+            return fillByRepair();
+        case FillMode::Tiles:
+            return fillByTiles();
+        default:
+            return fillByRejection();
+        }
+    }
+
+    // Fill cells by rejection on this many threads; see fillInBlocks(). 0,
+    // the default, fills the grid in one pass in reading order instead.
+    void setFillThreads(int threads) { fillThreads = std::max(0, threads); }
+
+    // How many cells more than an equal share any letter may take in the
+    // balanced fill
+    void setLetterTolerance(int tolerance) { letterTolerance = std::max(0, tolerance); }
+
+    // Keep transposed and diagonal copies of the grid, written along with
+    // every cell, so the banned-word scans read columns and diagonals from
+    // contiguous memory instead of striding across rows. Each write costs
+    // three more stores, which pays off once the grid outgrows the cache.
+    // A wrap-around grid reads its lines from the halo instead.
+    void setShadowGrids(bool enabled) {
+        std::vector<char>().swap(transposed);
+        std::vector<char>().swap(diagonals);
+        std::vector<char>().swap(antiDiagonals);
+        std::vector<int>().swap(diagonalStart);
+        std::vector<int>().swap(antiDiagonalStart);
+        if (!enabled || wrapAround || rows == 0 || cols == 0) {
+            return;
+        }
+        transposed.resize(rows * cols);
+        diagonals.resize(rows * cols);
+        antiDiagonals.resize(rows * cols);
+        for (int k = -(rows - 1), start = 0; k <= cols - 1; ++k) { // k = c - r
+            diagonalStart.push_back(start);
+            start += std::min(rows - 1, cols - 1 - k) - std::max(0, -k) + 1;
+        }
+        for (int k = 0, start = 0; k <= rows + cols - 2; ++k) { // k = r + c
+            antiDiagonalStart.push_back(start);
+            start += std::min(rows - 1, k) - std::max(0, k - (cols - 1)) + 1;
+        }
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                setCell(r, c, grid[r][c]);
+            }
+        }
+    }
+
+    // Let lines run off one edge of the grid and back on at the opposite
+    // one, making it a torus: words are placed across the edges, and banned
+    // words are found across them too. The grid is kept inside a halo, a
+    // border as wide as the longest word reaches holding copies of the
+    // opposite edges, so probes and the banned-word checks read straight
+    // across an edge without wrapping coordinates. The bitboards keep the
+    // grid's width and rotate their rows instead. No line may repeat a
+    // cell, so words and banned words must fit the shorter side; returns
+    // false, leaving the grid rectangular, if some do not. Call before
+    // placing words.
+    bool setWrapAround(bool enabled) {
+        int longest = std::max(longestWord(words), matcher->maxLength());
+        if (enabled && longest > std::min(rows, cols)) {
+            return false;
+        }
+        wrapAround = enabled;
+        halo = enabled ? std::max(0, longest - 1) : 0;
+        haloCols = enabled ? cols + 2 * halo : 0;
+        std::vector<char>(enabled ? (rows + 2 * halo) * haloCols : 0, ' ').swap(haloGrid);
+        if (enabled) {
+            setShadowGrids(false);
+        }
+        boards = LetterBoards(rows, cols, words, enabled);
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                setCell(r, c, grid[r][c]);
+                if (grid[r][c] != ' ') {
+                    boards.set(r, c, grid[r][c]);
+                }
+            }
+        }
+        return true;
+    }
+
+    // When no banned word can occur, give every empty cell one random letter
+    // with no checks at all. These are the letters the rejection fill would
+    // draw, so the puzzle comes out the same, only faster. The deadline is
+    // read as often as the rejection fill reads it.
+    bool fillWithoutChecks() {
+        std::uniform_int_distribution<int> letterDist(0, letters.size() - 1);
+        bool outOfTime = false;
+        int cellsFilled = 0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (grid[r][c] != ' ') {
+                    continue;
+                }
+                if (hasDeadline && !outOfTime && cellsFilled++ % 64 == 0 && std::chrono::steady_clock::now() > fillDeadline) {
+                    outOfTime = true;
+                    puzzleStats.deadlineExceeded = true;
+                }
+                if (outOfTime) {
+                    ++puzzleStats.unfilledCells;
+                } else {
+                    setCell(r, c, letters[letterDist(rng)]);
+                }
+            }
+        }
+        return !outOfTime;
+    }
+
+    // Fill cell by cell, drawing letters until one forms no banned word
+    bool fillByRejection() {
+        if (fillThreads > 0 && !wrapAround) { // Blocks across an edge would touch
+            return fillInBlocks();
+        }
+        bool filled = true;
+        bool outOfTime = false;
+        int cellsFilled = 0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (grid[r][c] == ' ') {
+                    // Reading the clock for every cell would cost more than most fills
+                    if (hasDeadline && !outOfTime && cellsFilled++ % 64 == 0 && std::chrono::steady_clock::now() > fillDeadline) {
+                        outOfTime = true;
+                        puzzleStats.deadlineExceeded = true;
+                    }
+                    if (outOfTime) {
+                        ++puzzleStats.unfilledCells;
+                        filled = false;
+                        continue;
+                    }
+                    filled = fillCell(r, c, rng, line, puzzleStats) && filled;
+                }
+            }
+        }
+        return filled;
+    }
+
+    // Fill one empty cell with random letters from the given generator until
+    // one forms no banned word. Returns false, leaving the cell empty and
+    // counting it as unfilled, if every letter forms one. With discouraged
+    // words, a letter forming one is kept only if every other letter forms
+    // a banned word or as heavy a discouraged one. The cells after this one
+    // are still empty, so the penalty through it is the weight of the
+    // discouraged words it completes.
+    bool fillCell(int r, int c, std::mt19937& generator, std::vector<char>& buffer, PuzzleStats& stats) {
+        char randomLetter;
+        bool validLetter = false;
+        std::bitset<256> tried; // Letters already tried for this cell
+        int triedCount = 0;
+        char best = ' ';
+        std::uint64_t lowestPenalty = 0;
+
+        // Keep generating random letters until a valid one is found,
+        // or every letter has been rejected
+        while (!validLetter && triedCount < distinctLetters) {
+            randomLetter = getRandomLetter(generator);
+            unsigned char index = static_cast<unsigned char>(randomLetter);
+            if (tried[index]) {
+                continue; // Already tried here
+            }
+            setCell(r, c, randomLetter); // Place random letter
+
+            ++stats.bannedChecks;
+            if (!bannedWordAt(r, c, buffer)) {
+                validLetter = true; // Accept the letter if no banned words are formed
+                if (matcher->hasDiscouragedWords()) {
+                    std::uint64_t penalty = discouragedPenaltyAt(r, c, buffer);
+                    if (best == ' ' || penalty < lowestPenalty) {
+                        best = randomLetter;
+                        lowestPenalty = penalty;
+                    }
+                    validLetter = penalty == 0;
+                    setCell(r, c, ' ');
+                    tried[index] = true;
+                    ++triedCount;
+                }
+            } else {
+                setCell(r, c, ' '); // Reset if a banned word is formed
+                ++stats.fillRejections;
+                tried[index] = true;
+                ++triedCount;
+            }
+        }
+        if (best != ' ') {
+            setCell(r, c, best);
+            stats.discouragedPenalty += lowestPenalty;
+            validLetter = true;
+        }
+        if (!validLetter) {
+            ++stats.unfilledCells;
+        }
+        return validLetter;
+    }
+
+    // The balanced fill. Each letter's share is the cells holding a fill
+    // letter or empty, split evenly and rounded up; its quota is its share
+    // plus letterTolerance. Every empty cell, in reading order, first finds
+    // which letters form no banned word there, one check each, then draws
+    // one of them with odds in proportion to the square of how far it is
+    // below its share; squaring catches up letters that banned words hold
+    // back before the grid runs out. Once every fitting letter has its
+    // share, one under quota is drawn evenly, and only when all are at
+    // quota does one go over it.
+    bool fillBalanced() {
+        std::vector<char> candidates;
+        std::vector<int> indexOf(256, -1);
+        for (char letter : letters) {
+            int& index = indexOf[static_cast<unsigned char>(letter)];
+            if (index < 0) {
+                index = static_cast<int>(candidates.size());
+                candidates.push_back(letter);
+            }
+        }
+        int letterCount = static_cast<int>(candidates.size());
+        if (letterCount == 0) { // Nothing to fill with: every empty cell stays empty
+            for (const auto& row : grid) {
+                puzzleStats.unfilledCells += static_cast<int>(std::count(row.begin(), row.end(), ' '));
+            }
+            return puzzleStats.unfilledCells == 0;
+        }
+        std::vector<int> counts(letterCount, 0);
+        int capacity = 0;
+        for (const auto& row : grid) {
+            for (char cell : row) {
+                int index = indexOf[static_cast<unsigned char>(cell)];
+                if (index >= 0) {
+                    ++counts[index];
+                }
+                capacity += cell == ' ' || index >= 0;
+            }
+        }
+        int share = (capacity + letterCount - 1) / letterCount;
+        int quota = share + letterTolerance;
+
+        std::vector<std::uint64_t> weights(letterCount);
+        bool filled = true;
+        bool outOfTime = false;
+        int cellsFilled = 0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (grid[r][c] != ' ') {
+                    continue;
+                }
+                if (hasDeadline && !outOfTime && cellsFilled++ % 64 == 0 && std::chrono::steady_clock::now() > fillDeadline) {
+                    outOfTime = true;
+                    puzzleStats.deadlineExceeded = true;
+                }
+                if (outOfTime) {
+                    ++puzzleStats.unfilledCells;
+                    filled = false;
+                    continue;
+                }
+
+                // Letters that fit, weighted by the first tier that has any
+                int fitting = 0, belowShare = 0, belowQuota = 0;
+                for (int i = 0; i < letterCount; ++i) {
+                    bool fits = true;
+                    if (fillNeedsChecks) {
+                        setCell(r, c, candidates[i]);
+                        ++puzzleStats.bannedChecks;
+                        fits = !bannedWordAt(r, c);
+                        puzzleStats.fillRejections += !fits;
+                    }
+                    weights[i] = fits ? 1 : 0;
+                    fitting += fits;
+                    belowShare += fits && counts[i] < share;
+                    belowQuota += fits && counts[i] < quota;
+                }
+                setCell(r, c, ' ');
+                if (fitting == 0) {
+                    ++puzzleStats.unfilledCells;
+                    filled = false;
+                    continue;
+                }
+                std::uint64_t total = 0;
+                for (int i = 0; i < letterCount; ++i) {
+                    if (belowShare > 0) {
+                        std::uint64_t need = std::max(0, share - counts[i]);
+                        weights[i] *= need * need;
+                    } else if (belowQuota > 0) {
+                        weights[i] *= counts[i] < quota;
+                    }
+                    total += weights[i];
+                }
+                std::uint64_t pick = std::uniform_int_distribution<std::uint64_t>(0, total - 1)(rng);
+                int chosen = 0;
+                while (pick >= weights[chosen]) {
+                    pick -= weights[chosen++];
+                }
+                setCell(r, c, candidates[chosen]);
+                puzzleStats.quotaOverruns += counts[chosen]++ >= quota;
+            }
+        }
+        auto range = std::minmax_element(counts.begin(), counts.end());
+        puzzleStats.letterSpread = *range.second - *range.first;
+        return filled;
+    }
+
+    // The rejection fill on fillThreads threads. The grid is cut into square
+    // blocks at least as wide as the longest banned word less one, coloured
+    // in a 2x2 pattern: no banned word can reach from a block into another of
+    // the same colour, so filling one never reads a cell being written in the
+    // other. The colours are filled one after another, the blocks of each by
+    // whichever thread is free, each block in reading order with its own
+    // generator seeded from the puzzle's and the block's number. The grid
+    // comes out the same whatever the number of threads.
+    bool fillInBlocks() {
+        int side = std::max(parallelFillBlockSide, matcher->maxLength() - 1);
+        int blockRows = (rows + side - 1) / side;
+        int blockCols = (cols + side - 1) / side;
+        std::uint32_t puzzleSeed = rng();
+        std::vector<PuzzleStats> blockStats(blockRows * blockCols);
+
+        auto fillBlock = [&](int block, std::vector<char>& buffer) {
+            std::seed_seq seeds = { puzzleSeed, static_cast<std::uint32_t>(block) };
+            std::mt19937 generator(seeds);
+            PuzzleStats& stats = blockStats[block];
+            int top = block / blockCols * side;
+            int left = block % blockCols * side;
+            bool outOfTime = false;
+            int cellsFilled = 0;
+            for (int r = top; r < std::min(rows, top + side); ++r) {
+                for (int c = left; c < std::min(cols, left + side); ++c) {
+                    if (grid[r][c] != ' ') {
+                        continue;
+                    }
+                    if (hasDeadline && !outOfTime && cellsFilled++ % 64 == 0 && std::chrono::steady_clock::now() > fillDeadline) {
+                        outOfTime = true;
+                        stats.deadlineExceeded = true;
+                    }
+                    if (outOfTime) {
+                        ++stats.unfilledCells;
+                    } else {
+                        fillCell(r, c, generator, buffer, stats);
+                    }
+                }
+            }
+        };
+
+        for (int colour = 0; colour < 4; ++colour) {
+            std::vector<int> blocks;
+            for (int br = colour / 2; br < blockRows; br += 2) {
+                for (int bc = colour % 2; bc < blockCols; bc += 2) {
+                    blocks.push_back(br * blockCols + bc);
+                }
+            }
+            std::atomic<int> nextBlock(0);
+            auto work = [&] {
+                std::vector<char> buffer(line.size());
+                for (int i = nextBlock++; i < static_cast<int>(blocks.size()); i = nextBlock++) {
+                    fillBlock(blocks[i], buffer);
+                }
+            };
+            std::vector<std::thread> helpers;
+            for (int t = 1; t < std::min<int>(fillThreads, blocks.size()); ++t) {
+                helpers.emplace_back(work);
+            }
+            work();
+            for (auto& helper : helpers) {
+                helper.join();
+            }
+        }
+
+        bool filled = true;
+        for (const auto& stats : blockStats) {
+            puzzleStats.bannedChecks += stats.bannedChecks;
+            puzzleStats.fillRejections += stats.fillRejections;
+            puzzleStats.unfilledCells += stats.unfilledCells;
+            puzzleStats.discouragedPenalty += stats.discouragedPenalty;
+            puzzleStats.deadlineExceeded = puzzleStats.deadlineExceeded || stats.deadlineExceeded;
+            filled = filled && stats.unfilledCells == 0;
+        }
+        return filled;
+    }
+
+    // Whether a banned word, read in any of the eight directions, passes
+    // through (r, c). Only the four lines through the cell are scanned, as far
+    // as the longest banned word reaches, clipped to the grid up front.
+    bool bannedWordAt(int r, int c) const {
+        return bannedWordAt(r, c, line);
+    }
+
+    // The same, reading the lines into the given buffer
+    bool bannedWordAt(int r, int c, std::vector<char>& buffer) const {
+        static const std::pair<int, int> axes[] = { {0, 1}, {1, 0}, {1, 1}, {1, -1} };
+        if (matcher->empty()) {
+            return false;
         }
-        std::cout << prefix << message << std::endl;
+        int reach = matcher->maxLength() - 1;
+        for (const auto& axis : axes) {
+            int before = std::min(reach, stepsToEdge(r, c, -axis.first, -axis.second));
+            int after = std::min(reach, stepsToEdge(r, c, axis.first, axis.second));
+            if (matcher->occursThrough(lineThrough(r, c, axis.first, axis.second, before, after, buffer), before + after + 1, before)) {
+                return true;
+            }
+        }
+        return false;
     }
-}
 
-class WordSearch {
-public:
-    WordSearch(int rows, int cols, const std::vector<std::string>& words, const std::vector<char>& letters, const std::unordered_set<std::string>& bannedWords)
-        : rows(rows), cols(cols), words(words), letters(letters), bannedWords(bannedWords), rng(std::random_device{}()) {
-        grid.resize(rows, std::vector<char>(cols, ' ')); // Initialize the grid with empty spaces
+    // Summed weight of the discouraged words, read in any of the eight
+    // directions, passing through (r, c), scanning the same four lines
+    std::uint64_t discouragedPenaltyAt(int r, int c, std::vector<char>& buffer) const {
+        static const std::pair<int, int> axes[] = { {0, 1}, {1, 0}, {1, 1}, {1, -1} };
+        std::uint64_t penalty = 0;
+        int reach = matcher->maxLength() - 1;
+        for (const auto& axis : axes) {
+            int before = std::min(reach, stepsToEdge(r, c, -axis.first, -axis.second));
+            int after = std::min(reach, stepsToEdge(r, c, axis.first, axis.second));
+            penalty += matcher->penaltyThrough(lineThrough(r, c, axis.first, axis.second, before, after, buffer), before + after + 1, before);
+        }
+        return penalty;
     }
 
-    // Generate the word search puzzle
-    void generate() {
-        log(LogLevel::DEBUG, "Shuffling words...");
-        std::shuffle(words.begin(), words.end(), rng); // Shuffle words for random placement
+    // Whether a banned word occurs anywhere in the grid, scanning every row,
+    // column and diagonal once with the matcher
+    bool bannedWordAnywhere() const {
+        if (matcher->empty()) {
+            return false;
+        }
+        std::vector<char> buffer(std::max(rows, cols));
+        if (wrapAround) {
+            return forEachCycle(matcher->maxLength() - 1, buffer, [&](const char* cells, int length) { return matcher->occursIn(cells, length); });
+        }
+        return forEachLine([&](int row, int col, int dr, int dc) {
+            int after = stepsToEdge(row, col, dr, dc);
+            return matcher->occursIn(lineThrough(row, col, dr, dc, 0, after, buffer), after + 1);
+        });
+    }
+
+    // Summed weight of the discouraged words in the grid, scanning every
+    // line once with the matcher
+    std::uint64_t discouragedPenaltyAnywhere() const {
+        std::uint64_t penalty = 0;
+        if (!matcher->hasDiscouragedWords()) {
+            return penalty;
+        }
+        std::vector<char> buffer(std::max(rows, cols));
+        if (wrapAround) {
+            int reach = matcher->maxLength() - 1;
+            forEachCycle(reach, buffer, [&](const char* cells, int length) {
+                matcher->forEachDiscouragedMatch(cells, length, reach, [&](int, int, int weight) { penalty += weight; });
+                return false;
+            });
+            return penalty;
+        }
+        forEachLine([&](int row, int col, int dr, int dc) {
+            int after = stepsToEdge(row, col, dr, dc);
+            matcher->forEachDiscouragedMatch(lineThrough(row, col, dr, dc, 0, after, buffer), after + 1, 0,
+                                             [&](int, int, int weight) { penalty += weight; });
+            return false;
+        });
+        return penalty;
+    }
+
+    // Reference banned-word checks: the original brute-force scans, kept to
+    // validate the matcher-based checks above
+    bool referenceContainsBannedWords() const {
+        return containsBannedWords();
+    }
+
+    bool referenceBannedWordAt(int r, int c) const {
+        static const std::vector<std::pair<int, int>> directions = {
+            {0, 1}, {1, 0}, {1, 1}, {0, -1}, {-1, 0}, {-1, -1}, {1, -1}, {-1, 1}
+        };
+        for (const auto& bannedWord : bannedWords) {
+            if (BannedWordMatcher::isDiscouraged(bannedWord)) {
+                continue; // May appear
+            }
+            bool fuzzy = BannedWordMatcher::isFuzzy(bannedWord);
+            // A ~ entry's near-spellings are at most one letter longer than
+            // its word, the length of the entry itself
+            for (const auto& dir : directions) {
+                for (int i = 0; i < static_cast<int>(bannedWord.length()); ++i) {
+                    int startRow = r - dir.first * i;
+                    int startCol = c - dir.second * i;
+                    // canFormWord only bounds-checks the end of the word
+                    if ((wrapAround || (startRow >= 0 && startRow < rows && startCol >= 0 && startCol < cols)) &&
+                        (fuzzy ? canFormNearSpelling(bannedWord.substr(1), startRow, startCol, dir.first, dir.second, i)
+                               : canFormWord(bannedWord, startRow, startCol, dir.first, dir.second))) {
+                        return true; // An occurrence covers (r, c) at offset i
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Summed weight of every discouraged word in the grid, found by trying
+    // each word from each cell in each direction
+    std::uint64_t referenceDiscouragedPenalty() const {
+        static const std::vector<std::pair<int, int>> directions = {
+            {0, 1}, {1, 0}, {1, 1}, {0, -1}, {-1, 0}, {-1, -1}, {1, -1}, {-1, 1}
+        };
+        std::uint64_t penalty = 0;
+        for (const auto& entry : bannedWords) {
+            std::string word;
+            int weight;
+            if (!BannedWordMatcher::isDiscouraged(entry, word, weight) || weight == 0) {
+                continue;
+            }
+            // A palindrome is found once from each end; count it once
+            bool palindrome = std::equal(word.begin(), word.end(), word.rbegin());
+            int found = 0;
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < cols; ++c) {
+                    for (const auto& dir : directions) {
+                        found += canFormWord(word, r, c, dir.first, dir.second);
+                    }
+                }
+            }
+            penalty += static_cast<std::uint64_t>(palindrome ? found / 2 : found) * weight;
+        }
+        return penalty;
+    }
+
+    // Every slot where the word, one of the puzzle's words, fits: found with
+    // the bitboards, and found by checking each slot cell by cell to
+    // validate the bitboards
+    std::vector<WordPlacement> fittingSlots(const std::string& word) const {
+        std::vector<WordPlacement> slots;
+        forEachFittingSlot(word, [&](int row, int col, int dr, int dc) {
+            slots.push_back({ -1, row, col, dr, dc });
+            return false;
+        });
+        return slots;
+    }
+
+    std::vector<WordPlacement> referenceFittingSlots(const std::string& word) const {
+        std::vector<WordPlacement> slots;
+        for (int d = 0; d < placementDirectionCount; ++d) {
+            int dr = placementDirections[d].first;
+            int dc = placementDirections[d].second;
+            const SlotRect& rect = slotTable->slots(word.length(), d);
+            for (int row = wrapAround ? 0 : rect.rowBegin; row < (wrapAround ? rows : rect.rowEnd); ++row) {
+                for (int col = wrapAround ? 0 : rect.colBegin; col < (wrapAround ? cols : rect.colEnd); ++col) {
+                    bool fits = true; // Read cell by cell, across the edges of a wrap-around grid
+                    for (int i = 0; i < static_cast<int>(word.length()); ++i) {
+                        char letter = cell(row + dr * i, col + dc * i);
+                        fits = fits && (letter == ' ' || letter == word[i]);
+                    }
+                    if (fits) {
+                        slots.push_back({ -1, row, col, dr, dc });
+                    }
+                }
+            }
+        }
+        return slots;
+    }
+
+    // Replace the grid contents, one string per row. Short rows are padded
+    // with empty cells and anything beyond the grid is ignored.
+    void setGrid(const std::vector<std::string>& lines) {
+        occupiedCells = 0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                setCell(r, c, r < static_cast<int>(lines.size()) && c < static_cast<int>(lines[r].size()) ? lines[r][c] : ' ');
+                occupiedCells += grid[r][c] != ' ';
+            }
+        }
+        boards.clear();
+        std::bitset<256> gridLetters;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (grid[r][c] != ' ') {
+                    boards.set(r, c, grid[r][c]);
+                    gridLetters[static_cast<unsigned char>(grid[r][c])] = true;
+                }
+            }
+        }
         for (const auto& word : words) {
-            if (bannedWords.find(word) == bannedWords.end()) {
-                log(LogLevel::DEBUG, "Placing word: " + word);
-                placeWord(word); // Place each word in the grid
-            } else {
-                log(LogLevel::DEBUG, "Skipping banned word: " + word);
+            for (char letter : word) {
+                gridLetters[static_cast<unsigned char>(letter)] = true;
             }
         }
+        updateFillChecks(gridLetters);
+    }
 
-        // Fill remaining empty cells with random letters
-        fillGrid();
+    // This puzzle with its placed words where they are and every other cell
+    // empty again, for fillGrid() to fill from a new seed. Variants of one
+    // placement differ only in their fill and skip placement entirely; their
+    // counters start from the words the puzzle holds.
+    WordSearch variant(unsigned seed) const {
+        WordSearch copy(*this);
+        copy.rng.seed(seed);
+        copy.keepOnlyPlacedWords();
+        copy.puzzleStats = PuzzleStats();
+        copy.puzzleStats.wordsPlaced = puzzleStats.wordsPlaced;
+        copy.puzzleStats.wordsFailed = puzzleStats.wordsFailed;
+        copy.puzzleStats.wordsSkipped = puzzleStats.wordsSkipped;
+        copy.puzzleStats.deadlineExceeded = puzzleStats.wordsSkipped > 0;
+        return copy;
+    }
+
+    // Whether a word is banned, or is a near-spelling of a ~ banned entry
+    bool isBanned(const std::string& word) const {
+        if (bannedWords.count(word)) {
+            return true;
+        }
+        for (const auto& entry : bannedWords) {
+            if (BannedWordMatcher::isFuzzy(entry) && (word.size() >= static_cast<std::size_t>(fuzzyMinLength) || word == entry.substr(1)) &&
+                withinOneEdit(word, entry.substr(1))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Take one complete occurrence of each of the puzzle's words in a grid
+    // set by setGrid() as placed, and empty every other cell, so fillGrid()
+    // gives an archived puzzle a new background. A word's own placement, if
+    // this puzzle still has it, wins over occurrences the fill spelled by
+    // chance; those are left to the new fill. Words not in the grid count as
+    // failed. Returns the number of words found.
+    int restorePlacements() {
+        std::vector<WordPlacement> previous;
+        previous.swap(placedWords);
+        puzzleStats = PuzzleStats();
+        for (int i = 0; i < static_cast<int>(words.size()); ++i) {
+            const std::string& word = words[i];
+            if (isBanned(word)) {
+                continue; // Never placed
+            }
+            bool found = false;
+            forEachFittingSlot(word, [&](int row, int col, int dr, int dc) {
+                for (int k = 0; k < static_cast<int>(word.length()); ++k) {
+                    if (cell(row + dr * k, col + dc * k) == ' ') {
+                        return false; // Fits, but is not there
+                    }
+                }
+                WordPlacement placement = { i, row, col, dr, dc };
+                bool original = std::any_of(previous.begin(), previous.end(), [&](const WordPlacement& earlier) {
+                    return words[earlier.word] == word && earlier.row == row && earlier.col == col && earlier.dr == dr && earlier.dc == dc;
+                });
+                if (!found || original) {
+                    if (found) {
+                        placedWords.back() = placement;
+                    } else {
+                        placedWords.push_back(placement);
+                    }
+                    found = true;
+                }
+                return original; // Stop at the word's own placement
+            });
+            ++(found ? puzzleStats.wordsPlaced : puzzleStats.wordsFailed);
+        }
+        keepOnlyPlacedWords();
+        return puzzleStats.wordsPlaced;
+    }
+
+    // Counters collected while generating this puzzle
+    const PuzzleStats& stats() const { return puzzleStats; }
+
+    PuzzleResult result() const {
+        if (puzzleStats.unfilledCells > 0) {
+            return PuzzleResult::Failed;
+        }
+        return puzzleStats.wordsSkipped > 0 ? PuzzleResult::Degraded : PuzzleResult::Complete;
+    }
+
+    // The words placed so far, in placement order
+    const std::vector<WordPlacement>& placements() const { return placedWords; }
+    const std::string& word(const WordPlacement& placement) const { return words[placement.word]; }
+
+    // The letter at (r, c), which on a wrap-around grid may lie off the
+    // grid and is taken from the opposite edge
+    char cell(int r, int c) const {
+        if (wrapAround) {
+            return grid[(r % rows + rows) % rows][(c % cols + cols) % cols];
+        }
+        return grid[r][c];
     }
 
     // Print the grid to the specified output stream
@@ -90,15 +2245,558 @@ private:
     std::vector<char> letters; // Letters for filling empty spaces
     std::unordered_set<std::string> bannedWords; // Banned words that cannot appear in the grid
     std::vector<std::vector<char>> grid; // 2D grid for the puzzle
+    // Shadow grids, empty unless enabled: the grid by column, and by
+    // diagonal down-right (keyed c - r) and down-left (keyed r + c), each
+    // line stored in order of increasing row
+    std::vector<char> transposed, diagonals, antiDiagonals;
+    std::vector<int> diagonalStart, antiDiagonalStart; // Offset of each diagonal by key
+    // Wrap-around grids only: the grid inside a halo `halo` cells wide of
+    // copies of the opposite edges, row by row, haloCols to a row
+    bool wrapAround = false;
+    int halo = 0, haloCols = 0;
+    std::vector<char> haloGrid;
     std::mt19937 rng; // Random number generator
+    std::shared_ptr<const BannedWordMatcher> matcher; // Finds banned words along a line
+    std::shared_ptr<const SlotTable> slotTable; // Where each word length fits in the grid
+    mutable LetterBoards boards; // The placed letters, for finding every slot a word fits at once
+    mutable std::vector<char> line; // Scratch copy of the cells along one line, for the matcher
+    PuzzleStats puzzleStats;
+    std::vector<WordPlacement> placedWords;
+    int distinctLetters = 0; // Letters the fill can choose from, ignoring repeats
+    std::bitset<256> fillLetters;
+    std::bitset<256> nearSpellingLetters; // Letters the reference checks let near-spellings use
+    bool fillNeedsChecks = true; // False when no banned word can run through a filled cell
+    int occupiedCells = 0;   // Cells holding a placed word's letter
+    FillMode fillMode = FillMode::Rejection;
+    std::shared_ptr<const TileLibrary> tiles; // For FillMode::Tiles
+    int fillThreads = 0;
+    int letterTolerance = 1; // For FillMode::Balanced
+
+    // Repair fill state, by cell index r * cols + c
+    std::vector<int> coverage;       // Banned words covering the cell
+    std::vector<bool> repairable;    // Filled by the fill rather than by a word
+    std::vector<int> conflicted;     // Repairable cells inside a banned word
+    std::vector<int> conflictIndex;  // Position in `conflicted`, -1 if not there
+
+    // Placement probes and successes for this puzzle, by word length (the
+    // last bucket takes every longer word) and by quarter of the grid filled
+    struct PlacementHistory {
+        std::uint64_t probes = 0;
+        std::uint64_t successes = 0;
+    };
+    PlacementHistory placementHistory[placementLengthBuckets][placementFillBuckets];
+    bool hasDeadline = false;
+    std::chrono::steady_clock::time_point placementDeadline;
+    std::chrono::steady_clock::time_point fillDeadline;
+
+    // Call visit(row, col, dr, dc) with the first cell and direction of every
+    // row, column and diagonal, until it returns true. Returns whether it did.
+    template <typename Visit>
+    bool forEachLine(Visit visit) const {
+        for (int r = 0; r < rows; ++r) {
+            if (visit(r, 0, 0, 1) || visit(r, 0, 1, 1) || visit(r, cols - 1, 1, -1)) {
+                return true;
+            }
+        }
+        for (int c = 0; c < cols; ++c) {
+            if (visit(0, c, 1, 0) || (c > 0 && visit(0, c, 1, 1)) || (c < cols - 1 && visit(0, c, 1, -1))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Call visit(cells, length) with each row, column and diagonal of a
+    // wrap-around grid, each one a cycle, until it returns true. Returns
+    // whether it did. The cells are the cycle preceded by its last `reach`,
+    // so every occurrence up to reach + 1 cells long is read whole once,
+    // ending at position reach or later. Rows are read in place from the
+    // halo. The other lines are copied into buffer up to 64 neighbouring
+    // cycles at a time, walking the grid row by row, so each row is read in
+    // runs of cells rather than one cell per line.
+    template <typename Visit>
+    bool forEachCycle(int reach, std::vector<char>& buffer, Visit visit) const {
+        static const std::pair<int, int> axes[] = { {1, 0}, {1, 1}, {1, -1} };
+        const int block = 64;
+        for (int r = 0; r < rows; ++r) {
+            if (visit(&haloGrid[(r + halo) * haloCols + halo - reach], reach + cols)) {
+                return true;
+            }
+        }
+        // The diagonals in each direction form gcd(rows, cols) cycles, each
+        // through one of the first cells of row 0
+        int divisor = rows;
+        for (int rest = cols; rest != 0;) {
+            int next = divisor % rest;
+            divisor = rest;
+            rest = next;
+        }
+        for (const auto& axis : axes) {
+            int dc = axis.second;
+            int cycles = dc == 0 ? cols : divisor;
+            int length = reach + (dc == 0 ? rows : rows / divisor * cols);
+            for (int first = 0; first < cycles; first += block) {
+                int count = std::min(block, cycles - first);
+                buffer.resize(count * length);
+                int r = (rows - reach) % rows; // reach steps back from (0, first)
+                int c = ((first - dc * reach) % cols + cols) % cols;
+                for (int i = 0; i < length; ++i) {
+                    // The cycles' cells in this row are neighbours, up to
+                    // the right edge and then on from the left one
+                    const char* cells = grid[r].data();
+                    int run = std::min(count, cols - c);
+                    char* out = &buffer[i];
+                    for (int k = 0; k < run; ++k, out += length) {
+                        *out = cells[c + k];
+                    }
+                    for (int k = run; k < count; ++k, out += length) {
+                        *out = cells[c + k - cols];
+                    }
+                    r = r + 1 == rows ? 0 : r + 1;
+                    c += dc;
+                    c = c == cols ? 0 : c < 0 ? cols - 1 : c;
+                }
+                for (int k = 0; k < count; ++k) {
+                    if (visit(&buffer[k * length], length)) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Fill every empty cell with a random letter at once, then repair: take
+    // a filled cell inside a banned word and give it the letter that leaves
+    // the fewest banned words through it, until none are left. Each cell
+    // counts the banned words covering it; a change only recounts the lines
+    // through the changed cell, within reach of the longest banned word.
+    // Cells still inside a banned word when the step budget runs out are
+    // emptied and refilled by rejection.
+    bool fillByRepair() {
+        int cells = rows * cols;
+        coverage.assign(cells, 0);
+        conflictIndex.assign(cells, -1);
+        conflicted.clear();
+        repairable.assign(cells, false);
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                if (grid[r][c] == ' ') {
+                    setCell(r, c, getRandomLetter());
+                    repairable[r * cols + c] = true;
+                }
+            }
+        }
+
+        // Count the banned words already in the grid
+        std::vector<char> buffer(std::max(rows, cols));
+        forEachLine([&](int row, int col, int dr, int dc) {
+            int length = stepsToEdge(row, col, dr, dc) + 1;
+            const char* cells = lineThrough(row, col, dr, dc, 0, length - 1, buffer);
+            matcher->forEachLongestMatch(cells, length, 0, [&](int end, int matchLength) {
+                for (int k = end - matchLength + 1; k <= end; ++k) {
+                    addCoverage(row + dr * k, col + dc * k, 1);
+                }
+            });
+            if (matcher->hasDiscouragedWords()) {
+                matcher->forEachDiscouragedMatch(cells, length, 0, [&](int end, int matchLength, int weight) {
+                    bool filled = false;
+                    for (int k = end - matchLength + 1; k <= end; ++k) {
+                        filled = filled || repairable[(row + dr * k) * cols + col + dc * k];
+                    }
+                    puzzleStats.discouragedPenalty += filled ? weight : 0;
+                });
+            }
+            return false;
+        });
+
+        std::vector<char> candidates;
+        std::bitset<256> seen;
+        for (char letter : letters) {
+            if (!seen[static_cast<unsigned char>(letter)]) {
+                seen[static_cast<unsigned char>(letter)] = true;
+                candidates.push_back(letter);
+            }
+        }
+
+        const std::uint64_t maxSteps = 10 * static_cast<std::uint64_t>(cells) + 100;
+        for (std::uint64_t step = 0; step < maxSteps && !conflicted.empty(); ++step) {
+            if (hasDeadline && step % 64 == 0 && std::chrono::steady_clock::now() > fillDeadline) {
+                break; // The rejection fill below finds the deadline passed and leaves the cells empty
+            }
+            int cell = conflicted[std::uniform_int_distribution<int>(0, conflicted.size() - 1)(rng)];
+            int r = cell / cols;
+            int c = cell % cols;
+
+            // The letter with the fewest banned words through the cell, then
+            // the lightest discouraged ones, ties broken at random
+            char old = grid[r][c];
+            char best = old;
+            int fewest = -1;
+            std::uint64_t lightest = 0;
+            std::uint64_t oldPenalty = 0;
+            int ties = 0;
+            for (char letter : candidates) {
+                setCell(r, c, letter);
+                ++puzzleStats.bannedChecks;
+                int count = bannedWordsThrough(r, c);
+                std::uint64_t penalty = matcher->hasDiscouragedWords() ? discouragedPenaltyAt(r, c, line) : 0;
+                oldPenalty = letter == old ? penalty : oldPenalty;
+                if (fewest < 0 || count < fewest || (count == fewest && penalty < lightest)) {
+                    fewest = count;
+                    lightest = penalty;
+                    best = letter;
+                    ties = 1;
+                } else if (count == fewest && penalty == lightest && std::uniform_int_distribution<int>(0, ties++)(rng) == 0) {
+                    best = letter;
+                }
+            }
+            setCell(r, c, old);
+            if (best != old) {
+                updateCoverageAround(r, c, -1);
+                setCell(r, c, best);
+                updateCoverageAround(r, c, 1);
+                puzzleStats.discouragedPenalty += lightest;
+                puzzleStats.discouragedPenalty -= oldPenalty;
+            }
+            ++puzzleStats.repairSteps;
+        }
+
+        if (matcher->hasDiscouragedWords()) {
+            lowerDiscouragedPenalty(candidates);
+        }
+        if (conflicted.empty()) {
+            return true;
+        }
+        for (int cell : conflicted) {
+            if (matcher->hasDiscouragedWords()) {
+                puzzleStats.discouragedPenalty -= discouragedPenaltyAt(cell / cols, cell % cols, line);
+            }
+            setCell(cell / cols, cell % cols, ' ');
+        }
+        return fillByRejection();
+    }
+
+    // Sweep the filled cells outside any banned word twice, giving each
+    // that a discouraged word runs through the letter with the lightest
+    // ones that forms no banned word
+    void lowerDiscouragedPenalty(const std::vector<char>& candidates) {
+        for (int sweep = 0; sweep < 2; ++sweep) {
+            for (int cell = 0; cell < rows * cols; ++cell) {
+                int r = cell / cols;
+                int c = cell % cols;
+                if (!repairable[cell] || coverage[cell] > 0) {
+                    continue;
+                }
+                std::uint64_t current = discouragedPenaltyAt(r, c, line);
+                if (current == 0) {
+                    continue;
+                }
+                char old = grid[r][c];
+                char best = old;
+                std::uint64_t lightest = current;
+                for (char letter : candidates) {
+                    if (letter == old) {
+                        continue;
+                    }
+                    setCell(r, c, letter);
+                    ++puzzleStats.bannedChecks;
+                    if (bannedWordsThrough(r, c) > 0) {
+                        continue;
+                    }
+                    std::uint64_t penalty = discouragedPenaltyAt(r, c, line);
+                    if (penalty < lightest) {
+                        lightest = penalty;
+                        best = letter;
+                    }
+                }
+                setCell(r, c, old);
+                if (best != old) {
+                    updateCoverageAround(r, c, -1);
+                    setCell(r, c, best);
+                    updateCoverageAround(r, c, 1);
+                    puzzleStats.discouragedPenalty -= current - lightest;
+                    ++puzzleStats.repairSteps;
+                }
+            }
+        }
+    }
+
+    // Number of longest banned words ending at each position of the lines
+    // through (r, c) that cover it
+    int bannedWordsThrough(int r, int c) const {
+        int count = 0;
+        forEachLineAround(r, c, [&](int, int, int before, int end, int matchLength) {
+            count += end - matchLength + 1 <= before;
+        });
+        return count;
+    }
+
+    // Add delta to the coverage of each cell of the longest banned words
+    // ending at or after (r, c) on the lines through it. Only these can
+    // change when (r, c) does.
+    void updateCoverageAround(int r, int c, int delta) {
+        forEachLineAround(r, c, [&](int dr, int dc, int before, int end, int matchLength) {
+            for (int k = end - matchLength + 1; k <= end; ++k) {
+                addCoverage(r + dr * (k - before), c + dc * (k - before), delta);
+            }
+        });
+    }
+
+    // For each axis through (r, c), read the cells within reach of the
+    // longest banned word and call visit(dr, dc, before, end, matchLength)
+    // for the longest banned word ending at each position from (r, c) on.
+    // Positions count from the first cell read; (r, c) is at `before`.
+    template <typename Visit>
+    void forEachLineAround(int r, int c, Visit visit) const {
+        static const std::pair<int, int> axes[] = { {0, 1}, {1, 0}, {1, 1}, {1, -1} };
+        int reach = matcher->maxLength() - 1;
+        for (const auto& axis : axes) {
+            int before = std::min(reach, stepsToEdge(r, c, -axis.first, -axis.second));
+            int after = std::min(reach, stepsToEdge(r, c, axis.first, axis.second));
+            const char* cells = lineThrough(r, c, axis.first, axis.second, before, after, line);
+            matcher->forEachLongestMatch(cells, before + after + 1, before, [&](int end, int matchLength) {
+                visit(axis.first, axis.second, before, end, matchLength);
+            });
+        }
+    }
+
+    // Cover each empty block of tileSide x tileSide cells (cut short at the
+    // bottom and right edges) with a random tile that may sit beside the
+    // tiles to its left and above, then fill blocks holding placed letters,
+    // and blocks no tile fitted, by rejection. A tile holds no banned word,
+    // so one formed by placing it crosses the block's edge next to a letter
+    // already in the grid; only the edge cells with such a neighbour are
+    // checked.
+    bool fillByTiles() {
+        if (!tiles) {
+            tiles = TileLibrary::load("", letters, bannedWords, *matcher);
+        }
+        int side = tiles->side();
+        int blockRows = (rows + side - 1) / side;
+        int blockCols = (cols + side - 1) / side;
+        std::vector<int> blockTile(blockRows * blockCols, -1);
+        for (int br = 0; br < blockRows && tiles->count() > 0; ++br) {
+            if (hasDeadline && std::chrono::steady_clock::now() > fillDeadline) {
+                break; // The rejection fill below finds the deadline passed and leaves the cells empty
+            }
+            for (int bc = 0; bc < blockCols; ++bc) {
+                int top = br * side;
+                int left = bc * side;
+                int height = std::min(side, rows - top);
+                int width = std::min(side, cols - left);
+                if (!blockEmpty(top, left, height, width)) {
+                    continue;
+                }
+                int leftTile = bc > 0 ? blockTile[br * blockCols + bc - 1] : -1;
+                int aboveTile = br > 0 ? blockTile[(br - 1) * blockCols + bc] : -1;
+                for (int attempt = 0; attempt < tileAttempts; ++attempt) {
+                    int tile = tiles->pick(leftTile, aboveTile, rng);
+                    if (tile < 0) {
+                        break;
+                    }
+                    for (int r = 0; r < height; ++r) {
+                        for (int c = 0; c < width; ++c) {
+                            setCell(top + r, left + c, tiles->letter(tile, r, c));
+                        }
+                    }
+                    if (!bannedWordOnSeams(top, left, height, width)) {
+                        blockTile[br * blockCols + bc] = tile;
+                        ++puzzleStats.tilesPlaced;
+                        break;
+                    }
+                    for (int r = top; r < top + height; ++r) {
+                        for (int c = left; c < left + width; ++c) {
+                            setCell(r, c, ' ');
+                        }
+                    }
+                }
+            }
+        }
+        return fillByRejection();
+    }
+
+    bool blockEmpty(int top, int left, int height, int width) const {
+        for (int r = top; r < top + height; ++r) {
+            for (int c = left; c < left + width; ++c) {
+                if (grid[r][c] != ' ') {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Whether a banned word runs through an edge cell of the block that has
+    // a letter next to it outside the block
+    bool bannedWordOnSeams(int top, int left, int height, int width) {
+        for (int r = top; r < top + height; ++r) {
+            for (int c = left; c < left + width; ++c) {
+                bool edge = r == top || r == top + height - 1 || c == left || c == left + width - 1;
+                if (edge && letterOutsideNextTo(r, c, top, left, height, width)) {
+                    ++puzzleStats.bannedChecks;
+                    if (bannedWordAt(r, c)) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
 
-    // Check if a word can be placed in the specified direction
+    bool letterOutsideNextTo(int r, int c, int top, int left, int height, int width) const {
+        for (int nr = std::max(0, r - 1); nr <= std::min(rows - 1, r + 1); ++nr) {
+            for (int nc = std::max(0, c - 1); nc <= std::min(cols - 1, c + 1); ++nc) {
+                bool inside = nr >= top && nr < top + height && nc >= left && nc < left + width;
+                if (!inside && grid[nr][nc] != ' ') {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Change a cell's coverage, keeping the set of repairable cells inside a
+    // banned word up to date
+    void addCoverage(int r, int c, int delta) {
+        int cell = r * cols + c;
+        coverage[cell] += delta;
+        if (!repairable[cell]) {
+            return;
+        }
+        if (coverage[cell] > 0 && conflictIndex[cell] < 0) {
+            conflictIndex[cell] = conflicted.size();
+            conflicted.push_back(cell);
+        } else if (coverage[cell] == 0 && conflictIndex[cell] >= 0) {
+            int last = conflicted.back();
+            conflicted[conflictIndex[cell]] = last;
+            conflictIndex[last] = conflictIndex[cell];
+            conflicted.pop_back();
+            conflictIndex[cell] = -1;
+        }
+    }
+
+    // Empty every cell that does not hold a placed word's letter
+    void keepOnlyPlacedWords() {
+        std::vector<std::string> lines(rows, std::string(cols, ' '));
+        for (const auto& placement : placedWords) {
+            const std::string& word = words[placement.word];
+            for (int k = 0; k < static_cast<int>(word.length()); ++k) {
+                lines[wrapped(placement.row + placement.dr * k, rows)][wrapped(placement.col + placement.dc * k, cols)] = word[k];
+            }
+        }
+        setGrid(lines);
+    }
+
+    // Whether the fill has to check for banned words, given the letters
+    // other than fill letters that the grid may hold. With no banned words,
+    // or none that could be spelled through a filled cell or fit in a line,
+    // it does not.
+    void updateFillChecks(const std::bitset<256>& gridLetters) {
+        fillNeedsChecks = !matcher->empty() && matcher->canOccur(fillLetters, gridLetters, std::max(rows, cols));
+    }
+
+    // Every write to the grid goes through here, keeping the shadow grids
+    // or the halo in step
+    void setCell(int r, int c, char letter) {
+        grid[r][c] = letter;
+        if (wrapAround) {
+            forEachImage(r, c, [&](int hr, int hc) { haloGrid[hr * haloCols + hc] = letter; });
+        }
+        if (!transposed.empty()) {
+            transposed[c * rows + r] = letter;
+            diagonals[diagonalStart[c - r + rows - 1] + std::min(r, c)] = letter;
+            antiDiagonals[antiDiagonalStart[r + c] + r - std::max(0, r + c - (cols - 1))] = letter;
+        }
+    }
+
+    // Call visit(hr, hc) with the halo coordinates of the cell at (r, c) of
+    // a wrap-around grid and of each copy of it in the halo
+    template <typename Visit>
+    void forEachImage(int r, int c, Visit visit) const {
+        int firstRow = r + halo >= rows ? r + halo - rows : r + halo;
+        int firstCol = c + halo >= cols ? c + halo - cols : c + halo;
+        for (int hr = firstRow; hr < rows + 2 * halo; hr += rows) {
+            for (int hc = firstCol; hc < haloCols; hc += cols) {
+                visit(hr, hc);
+            }
+        }
+    }
+
+    // A row or column index at most one grid length out of range, brought
+    // back into it across the edge
+    static int wrapped(int index, int length) {
+        return index < 0 ? index + length : index >= length ? index - length : index;
+    }
+
+    // The cells from `before` steps back to `after` steps on from (r, c)
+    // along (dr, dc), one of the four line axes, as one contiguous run. Rows
+    // are read in place from the grid, and with shadow grids so are columns
+    // and diagonals; otherwise their cells are copied into buffer. A
+    // wrap-around grid reads them from the halo, across the edges.
+    const char* lineThrough(int r, int c, int dr, int dc, int before, int after, std::vector<char>& buffer) const {
+        if (wrapAround) {
+            const char* center = &haloGrid[(r + halo) * haloCols + c + halo];
+            if (dr == 0) {
+                return center - before;
+            }
+            int stride = dr * haloCols + dc;
+            int length = 0;
+            for (int k = -before; k <= after; ++k) {
+                buffer[length++] = center[k * stride];
+            }
+            return buffer.data();
+        }
+        if (dr == 0) {
+            return &grid[r][c - before];
+        }
+        if (!transposed.empty()) {
+            if (dc == 0) {
+                return &transposed[c * rows + r - before];
+            }
+            if (dc > 0) {
+                return &diagonals[diagonalStart[c - r + rows - 1] + std::min(r, c) - before];
+            }
+            return &antiDiagonals[antiDiagonalStart[r + c] + r - std::max(0, r + c - (cols - 1)) - before];
+        }
+        int length = 0;
+        for (int k = -before; k <= after; ++k) {
+            buffer[length++] = grid[r + dr * k][c + dc * k];
+        }
+        return buffer.data();
+    }
+
+    // How many steps from (r, c) in direction (dr, dc) stay inside the grid,
+    // or on a wrap-around grid inside the halo
+    int stepsToEdge(int r, int c, int dr, int dc) const {
+        if (wrapAround) {
+            return halo;
+        }
+        int steps = std::max(rows, cols);
+        if (dr != 0) {
+            steps = std::min(steps, dr > 0 ? rows - 1 - r : r);
+        }
+        if (dc != 0) {
+            steps = std::min(steps, dc > 0 ? cols - 1 - c : c);
+        }
+        return steps;
+    }
+
+    // Check if a word can be placed in the specified direction. The start
+    // must be one of the word's slots, so the word is known to be in bounds;
+    // on a wrap-around grid every cell is a start, and the word is read from
+    // the halo.
     bool canPlaceWord(const std::string& word, int row, int col, int dr, int dc) const {
         int wordLength = word.length();
-        // Check bounds
-        if (row + dr * (wordLength - 1) < 0 || row + dr * (wordLength - 1) >= rows ||
-            col + dc * (wordLength - 1) < 0 || col + dc * (wordLength - 1) >= cols) {
-            return false;
+        if (wrapAround) {
+            const char* cell = &haloGrid[(row + halo) * haloCols + col + halo];
+            int stride = dr * haloCols + dc;
+            for (int i = 0; i < wordLength; ++i, cell += stride) {
+                if (*cell != ' ' && *cell != word[i]) {
+                    return false;
+                }
+            }
+            return true;
         }
 
         // Check if the word fits in the grid
@@ -114,64 +2812,159 @@ private:
         return true;
     }
 
-    // Place a word in the grid
-    void placeWord(const std::string& word) {
-        static const std::vector<std::pair<int, int>> directions = { {0, 1}, {1, 0}, {1, 1}, {0, -1}, {-1, 0}, {-1, -1} };
-
-        std::uniform_int_distribution<int> rowDist(0, rows - 1);
-        std::uniform_int_distribution<int> colDist(0, cols - 1);
-        std::uniform_int_distribution<int> dirDist(0, directions.size() - 1);
-        const int maxAttempts = 100; // Max attempts to place a word
-
-        for (int attempts = 0; attempts < maxAttempts; ++attempts) {
-            int directionIndex = dirDist(rng);
-            int dr = directions[directionIndex].first;
-            int dc = directions[directionIndex].second;
-            int row = rowDist(rng);
-            int col = colDist(rng);
+    // Place a word, the one at wordIndex in the word list, in the grid.
+    // Random probes come first, as many as the success rate seen so far for
+    // words of this length at this fill level calls for. If they all miss,
+    // or random probing would likely cost more than checking every slot,
+    // every slot is checked and one that fits is picked at random.
+    void placeWord(const std::string& word, int wordIndex) {
+        int length = word.length();
+        PlacementHistory& history = placementHistory[std::min(length, placementLengthBuckets) - 1]
+                                                    [occupiedCells * placementFillBuckets / (rows * cols + 1)];
+        int slots = slotCount(length);
+        // A scan takes one bitboard pass per direction and row, each about
+        // as costly as one probe
+        int scanCost = placementDirectionCount * rows * ((cols + 63) / 64);
+        int budget = probeBudget(history, std::min(slots, scanCost));
+        puzzleStats.probeBudget += budget;
+
+        // Probes draw from the in-bounds slots only
+        std::uniform_int_distribution<int> slotDist(0, std::max(0, slots - 1));
+        for (int attempts = 0; attempts < budget; ++attempts) {
+            int directionIndex = 0, row = 0, col = 0;
+            if (wrapAround) {
+                int index = slotDist(rng);
+                directionIndex = index / (rows * cols);
+                row = index / cols % rows;
+                col = index % cols;
+            } else {
+                slotTable->slot(length, slotDist(rng), directionIndex, row, col);
+            }
+            int dr = placementDirections[directionIndex].first;
+            int dc = placementDirections[directionIndex].second;
+
+            ++history.probes;
+            ++puzzleStats.placementProbes;
+            if (canPlaceWord(word, row, col, dr, dc)) {
+                ++history.successes;
+                writeWord(word, wordIndex, row, col, dr, dc);
+                return; // Word placed successfully
+            }
+        }
+
+        if (slots > 0 && placeWordInAnySlot(word, wordIndex, history)) {
+            return;
+        }
+
+        ++puzzleStats.wordsFailed;
+        log(LogLevel::WARN, "Failed to place word: " + word + " after " + std::to_string(budget) + " attempts; no slot fits it.");
+    }
+
+    // Random probes allowed, given the probes and successes seen so far and
+    // what scanning every slot would cost in probes. Enough probes to succeed
+    // with 99% confidence at the estimated rate, but never more than the scan
+    // would cost, and none when even the expected cost is higher.
+    static int probeBudget(const PlacementHistory& history, int scanCost) {
+        double successRate = (history.successes + 1.0) / (history.probes + 2.0); // Laplace estimate
+        if (1.0 / successRate > scanCost) {
+            return 0;
+        }
+        if (successRate >= 1.0) {
+            return 1;
+        }
+        double probes = std::ceil(std::log(0.01) / std::log(1.0 - successRate));
+        return static_cast<int>(std::min(probes, static_cast<double>(scanCost)));
+    }
+
+    // Check every slot and place the word in one of those it fits, chosen at
+    // random. What the scan finds is exactly the success rate random probing
+    // would see, so it goes into the history as well.
+    bool placeWordInAnySlot(const std::string& word, int wordIndex, PlacementHistory& history) {
+        ++puzzleStats.slotScans;
+        int fitting = 0;
+        forEachFittingRun(word, [&](int, int, std::uint64_t bits, int, int) {
+            fitting += bitCount(bits);
+            return false;
+        });
+        history.probes += slotCount(word.length());
+        history.successes += fitting;
+        if (fitting == 0) {
+            return false;
+        }
+
+        int chosen = std::uniform_int_distribution<int>(0, fitting - 1)(rng);
+        forEachFittingRun(word, [&](int row, int col, std::uint64_t bits, int dr, int dc) {
+            int count = bitCount(bits);
+            if (chosen >= count) {
+                chosen -= count;
+                return false;
+            }
+            for (; chosen > 0; --chosen) {
+                bits &= bits - 1;
+            }
+            writeWord(word, wordIndex, row, col + lowestBit(bits), dr, dc);
+            return true;
+        });
+        return true;
+    }
+
+    // Slots for a word of the given length; on a wrap-around grid, every
+    // cell in every direction
+    int slotCount(int length) const {
+        return wrapAround ? placementDirectionCount * rows * cols : slotTable->slotCount(length);
+    }
 
-            if (canPlaceWord(word, row, col, dr, dc)) {
-                for (int i = 0; i < word.length(); ++i) {
-                    int newRow = row + dr * i;
-                    int newCol = col + dc * i;
-                    grid[newRow][newCol] = word[i]; // Place the word in the grid
+    // Call visit(row, col, dr, dc) for each slot the word fits, in a fixed
+    // order, until it returns true. On a wrap-around grid every cell is a
+    // start and the words are fitted across the edges.
+    template <typename Visit>
+    void forEachFittingSlot(const std::string& word, Visit visit) const {
+        forEachFittingRun(word, [&](int row, int col, std::uint64_t bits, int dr, int dc) {
+            for (; bits != 0; bits &= bits - 1) {
+                if (visit(row, col + lowestBit(bits), dr, dc)) {
+                    return true;
                 }
-                return; // Word placed successfully
             }
-        }
-
-        log(LogLevel::WARN, "Failed to place word: " + word + " after " + std::to_string(maxAttempts) + " attempts.");
+            return false;
+        });
     }
 
-    // Fill empty spaces in the grid with random letters
-    void fillGrid() {
-        log(LogLevel::DEBUG, "Filling the grid...");
-        for (int r = 0; r < rows; ++r) {
-            for (int c = 0; c < cols; ++c) {
-                if (grid[r][c] == ' ') {
-                    char randomLetter;
-                    bool validLetter = false;
-
-                    // Keep generating random letters until a valid one is found
-                    while (!validLetter) {
-                        randomLetter = getRandomLetter();
-                        grid[r][c] = randomLetter; // Place random letter
-
-                        if (!containsBannedWords()) {
-                            validLetter = true; // Accept the letter if no banned words are formed
-                        } else {
-                            grid[r][c] = ' '; // Reset if a banned word is formed
-                        }
-                    }
-                }
+    // forEachFittingSlot() up to 64 slots along a row at a time: calls
+    // visit(row, col, bits, dr, dc), bit k of bits set if the word fits at
+    // (row, col + k), so slots can be counted without visiting each one
+    template <typename Visit>
+    void forEachFittingRun(const std::string& word, Visit visit) const {
+        for (int d = 0; d < placementDirectionCount; ++d) {
+            int dr = placementDirections[d].first;
+            int dc = placementDirections[d].second;
+            auto run = [&](int row, int col, std::uint64_t bits) { return visit(row, col, bits, dr, dc); };
+            if (wrapAround ? boards.forEachFitAround(word, dr, dc, run)
+                           : boards.forEachFit(word, dr, dc, slotTable->slots(word.length(), d), run)) {
+                return;
             }
         }
     }
 
+    void writeWord(const std::string& word, int wordIndex, int row, int col, int dr, int dc) {
+        for (int i = 0; i < static_cast<int>(word.size()); ++i) {
+            int newRow = wrapped(row + dr * i, rows);
+            int newCol = wrapped(col + dc * i, cols);
+            occupiedCells += grid[newRow][newCol] == ' ';
+            setCell(newRow, newCol, word[i]); // Place the word in the grid
+            boards.set(newRow, newCol, word[i]);
+        }
+        ++puzzleStats.wordsPlaced;
+        placedWords.push_back({ wordIndex, row, col, dr, dc });
+    }
+
     // Get a random letter from the letters vector
     char getRandomLetter() {
+        return getRandomLetter(rng);
+    }
+
+    char getRandomLetter(std::mt19937& generator) const {
         std::uniform_int_distribution<int> letterDist(0, letters.size() - 1);
-        return letters[letterDist(rng)];
+        return letters[letterDist(generator)];
     }
 
     // Check if any banned words are formed in the grid
@@ -189,7 +2982,7 @@ private:
     // Check for banned words around the given position
     bool checkForBannedWordAround(int r, int c) const {
         for (const auto& bannedWord : bannedWords) {
-            if (checkForBannedWord(bannedWord, r, c)) {
+            if (!BannedWordMatcher::isDiscouraged(bannedWord) && checkForBannedWord(bannedWord, r, c)) {
                 return true; // Found a banned word
             }
         }
@@ -203,7 +2996,8 @@ private:
         };
 
         for (const auto& dir : directions) {
-            if (canFormWord(word, r, c, dir.first, dir.second)) {
+            if (BannedWordMatcher::isFuzzy(word) ? canFormNearSpelling(word.substr(1), r, c, dir.first, dir.second, 0)
+                                                 : canFormWord(word, r, c, dir.first, dir.second)) {
                 return true; // Found a match
             }
         }
@@ -211,12 +3005,38 @@ private:
         return false; // No match found
     }
 
+    // Check if the word, or a spelling one edit away from it, can be formed
+    // from the starting position in the given direction, reaching past its
+    // cell at offset `through`
+    bool canFormNearSpelling(const std::string& word, int row, int col, int dr, int dc, int through) const {
+        int wordLength = word.length();
+        for (int length = std::max(through + 1, wordLength - 1); length <= wordLength + 1; ++length) {
+            int endRow = row + dr * (length - 1);
+            int endCol = col + dc * (length - 1);
+            if (!wrapAround && (endRow < 0 || endRow >= rows || endCol < 0 || endCol >= cols)) {
+                break; // Longer spellings are out of bounds too
+            }
+            std::string cells;
+            for (int i = 0; i < length; ++i) {
+                cells += cell(row + dr * i, col + dc * i);
+            }
+            bool letters = true;
+            for (char letter : cells) {
+                letters = letters && nearSpellingLetters[static_cast<unsigned char>(letter)];
+            }
+            if (cells == word || (letters && length >= fuzzyMinLength && withinOneEdit(cells, word))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     // Check if a word can be formed from the starting position in the given direction
     bool canFormWord(const std::string& word, int row, int col, int dr, int dc) const {
         int wordLength = word.length();
 
-        if (row + dr * (wordLength - 1) < 0 || row + dr * (wordLength - 1) >= rows ||
-            col + dc * (wordLength - 1) < 0 || col + dc * (wordLength - 1) >= cols) {
+        if (!wrapAround && (row + dr * (wordLength - 1) < 0 || row + dr * (wordLength - 1) >= rows ||
+                            col + dc * (wordLength - 1) < 0 || col + dc * (wordLength - 1) >= cols)) {
             return false; // Out of bounds
         }
 
@@ -225,7 +3045,7 @@ private:
             int newRow = row + dr * i;
             int newCol = col + dc * i;
 
-            if (grid[newRow][newCol] != word[i]) {
+            if (cell(newRow, newCol) != word[i]) {
                 return false; // Mismatch found
             }
         }
@@ -234,101 +3054,945 @@ private:
     }
 };
 
-// Generate a single puzzle and save it to the output file
-void generatePuzzle(int puzzleNumber, const std::vector<std::string>& words, const std::vector<char>& letters,
-                    const std::unordered_set<std::string>& bannedWords, int rows, int cols, const std::string& outputFile) {
-    log(LogLevel::INFO, "Generating puzzle " + std::to_string(puzzleNumber + 1) + "...");
-    WordSearch ws(rows, cols, words, letters, bannedWords);
-    ws.generate();
-
-    // Save the generated grid to the output file
-    std::ofstream file(outputFile, std::ios::app);
-    if (file.is_open()) {
-        file << "Puzzle " << puzzleNumber + 1 << ":\n";
-        ws.printGrid(file); // Print the grid to the file
-        file << "\n";
-    } else {
-        log(LogLevel::ERROR, "Error opening output file.");
+// Process-wide counters and latency histograms, exported for monitoring.
+// Counters only ever increase, matching Prometheus counter semantics.
+struct Metrics {
+    std::atomic<std::uint64_t> puzzlesGenerated{0};
+    std::atomic<std::uint64_t> wordsPlaced{0};
+    std::atomic<std::uint64_t> wordsFailed{0};
+    std::atomic<std::uint64_t> fillRejections{0};
+    std::atomic<std::uint64_t> bannedChecks{0};
+    std::atomic<std::uint64_t> unfilledCells{0};
+    std::atomic<std::uint64_t> placementProbes{0};
+    std::atomic<std::uint64_t> probeBudget{0};
+    std::atomic<std::uint64_t> slotScans{0};
+    std::atomic<std::uint64_t> repairSteps{0};
+    std::atomic<std::uint64_t> tilesPlaced{0};
+    std::atomic<std::uint64_t> discouragedPenalty{0};
+    std::atomic<std::uint64_t> quotaOverruns{0};
+    std::atomic<std::uint64_t> puzzlesDegraded{0};
+    std::atomic<std::uint64_t> puzzlesFailed{0};
+    std::atomic<std::uint64_t> puzzleRetries{0};
+    std::atomic<std::uint64_t> bytesWritten{0};
+
+    std::mutex latencyMutex;
+    LatencyReport latency;
+
+    // Fold one finished puzzle into the totals
+    void recordPuzzle(const PuzzleStats& stats, PuzzleResult result, const LatencyReport& puzzleLatency) {
+        ++puzzlesGenerated;
+        if (result == PuzzleResult::Degraded) {
+            ++puzzlesDegraded;
+        } else if (result == PuzzleResult::Failed) {
+            ++puzzlesFailed;
+        }
+        wordsPlaced += stats.wordsPlaced;
+        wordsFailed += stats.wordsFailed;
+        fillRejections += stats.fillRejections;
+        bannedChecks += stats.bannedChecks;
+        unfilledCells += stats.unfilledCells;
+        placementProbes += stats.placementProbes;
+        probeBudget += stats.probeBudget;
+        slotScans += stats.slotScans;
+        repairSteps += stats.repairSteps;
+        tilesPlaced += stats.tilesPlaced;
+        discouragedPenalty += stats.discouragedPenalty;
+        quotaOverruns += stats.quotaOverruns;
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        latency.merge(puzzleLatency);
     }
+};
+
+Metrics metrics;
+
+// Append a Prometheus histogram (in seconds) built from an HDR latency histogram
+void writePrometheusHistogram(std::ostream& out, const std::string& name, const std::string& labels,
+                              const LatencyHistogram& histogram) {
+    static const double bucketSeconds[] = { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60 };
+    std::string separator = labels.empty() ? "" : ",";
+    for (double le : bucketSeconds) {
+        std::ostringstream bound;
+        bound << le;
+        out << name << "_bucket{" << labels << separator << "le=\"" << bound.str() << "\"} "
+            << histogram.countAtOrBelow(static_cast<std::uint64_t>(le * 1e6)) << "\n";
+    }
+    out << name << "_bucket{" << labels << separator << "le=\"+Inf\"} " << histogram.count() << "\n";
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << braces << " " << histogram.sum() / 1e6 << "\n";
+    out << name << "_count" << braces << " " << histogram.count() << "\n";
 }
 
-// Generate multiple puzzles in parallel
-void generatePuzzles(int numPuzzles, const std::vector<std::string>& words, const std::vector<char>& letters,
-                     const std::unordered_set<std::string>& bannedWords, int rows, int cols, const std::string& outputFile) {
-    // Clear the output file
-    std::ofstream clearFile(outputFile);
-    clearFile.close();
+// Render all metrics in the Prometheus text exposition format
+void writePrometheusMetrics(std::ostream& out) {
+    struct Counter { const char* name; const char* help; const std::atomic<std::uint64_t>& value; };
+    const Counter counters[] = {
+        { "wordsearch_puzzles_generated_total", "Puzzles generated.", metrics.puzzlesGenerated },
+        { "wordsearch_words_placed_total", "Words placed in puzzles.", metrics.wordsPlaced },
+        { "wordsearch_words_failed_total", "Words that could not be placed.", metrics.wordsFailed },
+        { "wordsearch_fill_rejections_total", "Random fill letters rejected for forming a banned word.", metrics.fillRejections },
+        { "wordsearch_banned_checks_total", "Checks for a banned word through a newly filled cell.", metrics.bannedChecks },
+        { "wordsearch_unfilled_cells_total", "Cells left empty because every letter formed a banned word.", metrics.unfilledCells },
+        { "wordsearch_placement_probes_total", "Random slots tried while placing words.", metrics.placementProbes },
+        { "wordsearch_probe_budget_total", "Random slot probes allowed by the adaptive budget while placing words.", metrics.probeBudget },
+        { "wordsearch_slot_scans_total", "Words placed or given up on by checking every slot.", metrics.slotScans },
+        { "wordsearch_repair_steps_total", "Letters changed by the repair fill to remove banned words.", metrics.repairSteps },
+        { "wordsearch_tiles_placed_total", "Blocks of cells covered with a tile by the tile fill.", metrics.tilesPlaced },
+        { "wordsearch_discouraged_penalty_total", "Weight of discouraged words through cells the fill wrote.", metrics.discouragedPenalty },
+        { "wordsearch_quota_overruns_total", "Letters the balanced fill placed over their quota because no other fitted.", metrics.quotaOverruns },
+        { "wordsearch_puzzles_degraded_total", "Puzzles missing words because placement ran out of time.", metrics.puzzlesDegraded },
+        { "wordsearch_puzzles_failed_total", "Puzzles written with empty cells.", metrics.puzzlesFailed },
+        { "wordsearch_puzzle_retries_total", "Puzzles started over with a new seed.", metrics.puzzleRetries },
+        { "wordsearch_output_bytes_written_total", "Bytes written to puzzle output files.", metrics.bytesWritten },
+    };
+    for (const auto& counter : counters) {
+        out << "# HELP " << counter.name << " " << counter.help << "\n";
+        out << "# TYPE " << counter.name << " counter\n";
+        out << counter.name << " " << counter.value.load() << "\n";
+    }
+
+    LatencyReport latency;
+    {
+        std::lock_guard<std::mutex> lock(metrics.latencyMutex);
+        latency = metrics.latency;
+    }
+    out << "# HELP wordsearch_puzzle_duration_seconds Time to generate and write one puzzle.\n";
+    out << "# TYPE wordsearch_puzzle_duration_seconds histogram\n";
+    writePrometheusHistogram(out, "wordsearch_puzzle_duration_seconds", "", latency.puzzle);
+    out << "# HELP wordsearch_phase_duration_seconds Time spent in each phase of generating a puzzle.\n";
+    out << "# TYPE wordsearch_phase_duration_seconds histogram\n";
+    for (int i = 0; i < phaseCount; ++i) {
+        writePrometheusHistogram(out, "wordsearch_phase_duration_seconds",
+                                 std::string("phase=\"") + phaseName(static_cast<Phase>(i)) + "\"", latency.phases[i]);
+    }
+}
 
-    std::vector<std::future<void>> futures;
+// Writes the metrics to a textfile (for node_exporter's textfile collector)
+// every `interval` while running, and once more when stopped. The file is
+// replaced atomically so the collector never reads a partial write.
+class MetricsExporter {
+public:
+    MetricsExporter(const std::string& path, std::chrono::seconds interval) : path(path), interval(interval) {}
 
-    auto startTime = std::chrono::high_resolution_clock::now();
+    ~MetricsExporter() { stop(); }
 
-    for (int i = 0; i < numPuzzles; ++i) {
-        // Launch puzzle generation in a separate thread
-        futures.emplace_back(std::async(std::launch::async, generatePuzzle, i, std::cref(words), std::cref(letters), std::cref(bannedWords), rows, cols, outputFile));
+    void start() {
+        worker = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping) {
+                if (!wake.wait_for(lock, this->interval, [this] { return stopping; })) {
+                    writeFile();
+                }
+            }
+        });
     }
 
-    for (auto& future : futures) {
-        future.get(); // Wait for all puzzles to finish
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        writeFile();
     }
 
-    auto endTime = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> totalElapsed = endTime - startTime;
-    log(LogLevel::INFO, "All puzzles generated in " + std::to_string(totalElapsed.count()) + " seconds.");
-}
+private:
+    std::string path;
+    std::chrono::seconds interval;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
 
-// Main function to get user input and initiate puzzle generation
-int main() {
+    void writeFile() const {
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::trunc);
+            if (!file.is_open()) {
+                log(LogLevel::ERROR, "Error opening metrics file " + tempPath + ".");
+                return;
+            }
+            writePrometheusMetrics(file);
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            log(LogLevel::ERROR, "Error replacing metrics file " + path + ".");
+        }
+    }
+};
 
-    std::cout << "Ultimate Word Search Generator  Copyright (C) 2024  Alexandra Dogwood" << std::endl;
-    std::cout << "This program comes with ABSOLUTELY NO WARRANTY; for details type 'show w'." << std::endl;
-    std::cout << "This is free software, and you are welcome to redistribute it under certain conditions; type 'show c' for details." << std::endl;
+// Measurements taken while generating puzzles: latency histograms and,
+// when enabled, hardware counter totals and heap allocations per phase
+struct PuzzleMeasurements {
+    LatencyReport latency;
+    HardwareCounterTotals hardware;
+    AllocationCounts allocations[phaseCount];
+
+    void merge(const PuzzleMeasurements& other) {
+        latency.merge(other.latency);
+        hardware.merge(other.hardware);
+        for (int i = 0; i < phaseCount; ++i) {
+            allocations[i] += other.allocations[i];
+        }
+    }
+};
 
+// Measurements for a whole job. Each worker measures into its own
+// PuzzleMeasurements and merges it here once its puzzle is done, so workers
+// never contend while measuring.
+struct JobMetrics {
+    std::mutex mutex;
+    PuzzleMeasurements measurements;
 
-    int rows, cols, numPuzzles;
-    std::string outputFile;
+    void merge(const PuzzleMeasurements& local) {
+        std::lock_guard<std::mutex> lock(mutex);
+        measurements.merge(local);
+    }
+};
+
+// Measures one phase for as long as it is in scope: wall time into the phase's
+// latency histogram, the heap allocations made on this thread and, when
+// counters are open, the hardware event deltas
+class PhaseScope {
+public:
+    PhaseScope(Phase phase, PuzzleMeasurements& measurements, const PerfCounters* perf)
+        : phase(phase), measurements(measurements), perf(perf), startAllocations(currentThreadAllocations()),
+          start(std::chrono::steady_clock::now()) {
+        if (perf) {
+            perf->read(startCounts);
+        }
+    }
+
+    ~PhaseScope() {
+        if (perf) {
+            std::uint64_t endCounts[hardwareEventCount];
+            perf->read(endCounts);
+            for (int e = 0; e < hardwareEventCount; ++e) {
+                measurements.hardware.values[static_cast<int>(phase)][e] += endCounts[e] - startCounts[e];
+            }
+            measurements.hardware.availableMask |= perf->availableMask();
+        }
+        // Allocations are read first so the histogram's own growth is not counted
+        measurements.allocations[static_cast<int>(phase)] += currentThreadAllocations() - startAllocations;
+        measurements.latency.phase(phase).record(microsSince(start));
+    }
+
+private:
+    Phase phase;
+    PuzzleMeasurements& measurements;
+    const PerfCounters* perf;
+    AllocationCounts startAllocations;
+    std::chrono::steady_clock::time_point start;
+    std::uint64_t startCounts[hardwareEventCount];
+};
+
+// Log the heap allocations made for one puzzle, in total and per phase
+void logPuzzleAllocations(int puzzleNumber, const PuzzleMeasurements& measurements, const AllocationCounts& total) {
+    std::string line = "Puzzle " + std::to_string(puzzleNumber + 1) + " allocations: total=" +
+                       std::to_string(total.allocations) + " (" + std::to_string(total.bytes) + " bytes)";
+    for (int i = 0; i < phaseCount; ++i) {
+        line += std::string(" ") + phaseName(static_cast<Phase>(i)) + "=" + std::to_string(measurements.allocations[i].allocations) +
+                " (" + std::to_string(measurements.allocations[i].bytes) + " bytes)";
+    }
+    log(LogLevel::INFO, line);
+}
+
+// How finished puzzles reach the output file (see PuzzleWriter)
+enum class WriterMode { Locked, Queued };
+
+// What to do with a puzzle that is not complete, because it ran out of time
+// or has cells no letter can fill. Degrade keeps the best-effort puzzle,
+// flagged in the output; Retry starts over with a new seed, up to the job's
+// maxAttempts, and keeps the last attempt if none is complete.
+enum class DeadlinePolicy { Degrade, Retry };
+
+// Everything that describes one batch of puzzles
+struct PuzzleJob {
+    int numPuzzles = 0;
+    int rows = 0;
+    int cols = 0;
     std::vector<std::string> words;
     std::vector<char> letters;
     std::unordered_set<std::string> bannedWords;
+    std::string outputFile;
+    unsigned seed = 0;  // 0 picks a random seed for the job
+    int numThreads = 0; // 0 uses one worker per hardware thread
+    WriterMode writerMode = WriterMode::Locked;
+    const std::atomic<bool>* cancel = nullptr; // When set, workers stop taking new puzzles
+    std::chrono::milliseconds puzzleDeadline{0}; // 0 for no time limit per puzzle
+    DeadlinePolicy deadlinePolicy = DeadlinePolicy::Degrade;
+    int maxAttempts = 3; // Attempts per puzzle under DeadlinePolicy::Retry
+    FillMode fillMode = FillMode::Rejection;
+    std::string tileCacheDir; // Where FillMode::Tiles caches its tile library, empty for no cache
+    int fillThreads = 0; // Threads filling each puzzle's grid, 0 for the single-pass fill
+    int letterTolerance = 1; // Cells over an equal share a letter may take under FillMode::Balanced
+    bool shadowGrids = false; // Keep column and diagonal copies of each grid for contiguous scans
+    bool wrapAround = false; // Let words and banned words run across the edges of each grid
+    int variants = 1; // Fills written for each placement
+    std::vector<std::vector<std::string>> archive; // Grids whose words are kept and refilled, instead of placing words
+};
 
-    std::cout << "Enter number of rows (e.g., 30): ";
-    std::cin >> rows;
-    std::cout << "Enter number of columns (e.g., 25): ";
-    std::cin >> cols;
+// Largest number of rows or columns a job may ask for
+const int maxGridSide = 1000;
 
-    std::cout << "Enter letters (e.g., A B C D): ";
+// Check a job's settings before generating anything. Returns a description
+// of the first problem found, or an empty string if the job is valid.
+std::string validateJob(const PuzzleJob& job) {
+    if (job.rows <= 0 || job.rows > maxGridSide || job.cols <= 0 || job.cols > maxGridSide) {
+        return "Rows and columns must be between 1 and " + std::to_string(maxGridSide) + ".";
+    }
+    if (job.letters.empty()) {
+        return "No letters provided.";
+    }
+    if (job.numPuzzles <= 0) {
+        return "Number of puzzles must be positive.";
+    }
+    if (job.variants <= 0) {
+        return "Number of variants must be positive.";
+    }
+    for (const auto& entry : job.bannedWords) {
+        std::string word;
+        int weight;
+        if (BannedWordMatcher::isDiscouraged(entry, word, weight) && weight == 0) {
+            return "Discouraged word " + entry + " needs a word and a weight from 1 to " + std::to_string(maxDiscouragedWeight) + ".";
+        }
+    }
+    if (job.wrapAround) {
+        // No line of a wrap-around grid may repeat a cell. A ~ entry's
+        // near-spellings are as long as the entry itself.
+        std::size_t side = std::min(job.rows, job.cols);
+        for (const auto& word : job.words) {
+            if (word.size() > side) {
+                return "Word " + word + " is longer than the " + std::to_string(side) + " letters a wrap-around grid this size allows.";
+            }
+        }
+        for (const auto& entry : job.bannedWords) {
+            if ((BannedWordMatcher::isFuzzy(entry) ? entry : BannedWordMatcher::wordOf(entry)).size() > side) {
+                return "Banned word " + entry + " is longer than the " + std::to_string(side) + " letters a wrap-around grid this size allows.";
+            }
+        }
+    }
+    if (!job.archive.empty()) {
+        if (static_cast<int>(job.archive.size()) < job.numPuzzles) {
+            return "The archive holds " + std::to_string(job.archive.size()) + " puzzle(s), fewer than the " +
+                   std::to_string(job.numPuzzles) + " asked for.";
+        }
+        for (std::size_t i = 0; i < job.archive.size(); ++i) {
+            const auto& grid = job.archive[i];
+            bool sized = static_cast<int>(grid.size()) == job.rows;
+            for (const auto& line : grid) {
+                sized = sized && static_cast<int>(line.size()) == job.cols;
+            }
+            if (!sized) {
+                return "Archived puzzle " + std::to_string(i + 1) + " is not " + std::to_string(job.rows) + "x" + std::to_string(job.cols) + ".";
+            }
+        }
+    }
+    return "";
+}
+
+// Read the grids of puzzles written by an earlier job: each starts after a
+// "Puzzle N...:" line and runs to the next empty line. Returns false with
+// `error` set if there are none.
+bool readArchive(std::istream& in, std::vector<std::vector<std::string>>& grids, std::string& error) {
+    grids.clear();
+    std::string line;
+    bool inGrid = false;
+    while (std::getline(in, line)) {
+        if (!inGrid && line.compare(0, 7, "Puzzle ") == 0 && !line.empty() && line.back() == ':') {
+            grids.emplace_back();
+            inGrid = true;
+        } else if (line.empty()) {
+            inGrid = false;
+        } else if (inGrid) {
+            grids.back().push_back(line);
+        }
+    }
+    if (grids.empty()) {
+        error = "No puzzles found in the archive.";
+        return false;
+    }
+    return true;
+}
+
+// Read a job's settings as answered at the interactive prompts, writing the
+// prompts to `prompts` when given. Returns false with `error` set if the
+// input ends early or the job is invalid.
+bool readJob(std::istream& in, std::ostream* prompts, PuzzleJob& job, std::string& error) {
+    auto prompt = [&](const char* text) {
+        if (prompts) {
+            *prompts << text;
+        }
+    };
+
+    prompt("Enter number of rows (e.g., 30): ");
+    in >> job.rows;
+    prompt("Enter number of columns (e.g., 25): ");
+    in >> job.cols;
+    if (!in || job.rows <= 0 || job.rows > maxGridSide || job.cols <= 0 || job.cols > maxGridSide) {
+        error = "Rows and columns must be between 1 and " + std::to_string(maxGridSide) + ".";
+        return false;
+    }
+
+    prompt("Enter letters (e.g., A B C D): ");
     std::string letterInput;
-    std::cin.ignore(); // Ignore remaining newline
-    std::getline(std::cin, letterInput);
+    in.ignore(); // Ignore remaining newline
+    std::getline(in, letterInput);
     std::istringstream letterStream(letterInput);
     char letter;
     while (letterStream >> letter) {
-        letters.push_back(letter);
+        job.letters.push_back(letter);
     }
-
-    if (letters.empty()) {
-        std::cerr << "Error: No letters provided. Exiting.\n";
-        return 1; // Exit if no letters are provided
+    if (job.letters.empty()) {
+        error = "No letters provided.";
+        return false;
     }
 
-    std::cout << "Enter words (type 'done' when finished): ";
+    prompt("Enter words (type 'done' when finished): ");
     std::string word;
-    while (std::cin >> word && word != "done") {
-        words.push_back(word);
+    while (in >> word && word != "done") {
+        job.words.push_back(word);
+    }
+
+    prompt("Enter banned words (type 'done' when finished): ");
+    while (in >> word && word != "done") {
+        job.bannedWords.insert(word);
+    }
+
+    prompt("Enter number of puzzles to generate: ");
+    in >> job.numPuzzles;
+
+    prompt("Enter output file name: ");
+    in >> job.outputFile;
+    if (!in) {
+        error = "Input ended before all settings were given.";
+        return false;
+    }
+
+    error = validateJob(job);
+    return error.empty();
+}
+
+// Seed for one puzzle of a job. Each puzzle's seed depends only on the job
+// seed, its number and the attempt, so output does not depend on which
+// worker builds it. Retries after the first attempt get seeds of their own.
+unsigned puzzleSeed(unsigned jobSeed, int puzzleNumber, int attempt = 0) {
+    unsigned seed;
+    if (attempt == 0) {
+        std::seed_seq sequence = { jobSeed, static_cast<unsigned>(puzzleNumber) };
+        sequence.generate(&seed, &seed + 1);
+    } else {
+        std::seed_seq sequence = { jobSeed, static_cast<unsigned>(puzzleNumber), static_cast<unsigned>(attempt) };
+        sequence.generate(&seed, &seed + 1);
+    }
+    return seed;
+}
+
+// The seed for the fill of one of a puzzle's variants after the first
+unsigned variantSeed(unsigned jobSeed, int puzzleNumber, int variant) {
+    std::seed_seq sequence = { jobSeed, static_cast<unsigned>(puzzleNumber), 0u, static_cast<unsigned>(variant) };
+    unsigned seed;
+    sequence.generate(&seed, &seed + 1);
+    return seed;
+}
+
+// Writes rendered puzzles to the output file in puzzle order, whichever order
+// the workers finish in. With WriterMode::Locked the worker that completes the
+// next puzzle in order writes it (and any that were waiting on it) under the
+// writer's lock. With WriterMode::Queued workers only queue their text and a
+// dedicated thread does all file I/O. Either way the time workers spend
+// waiting for the lock is tracked so output contention shows up in benchmarks.
+class PuzzleWriter {
+public:
+    PuzzleWriter(const std::string& outputFile, WriterMode mode) : mode(mode), file(outputFile, std::ios::trunc) {
+        if (!file.is_open()) {
+            log(LogLevel::ERROR, "Error opening output file.");
+        }
+        if (mode == WriterMode::Queued) {
+            writerThread = std::thread([this] { writeQueued(); });
+        }
+    }
+
+    ~PuzzleWriter() { finish(); }
+
+    void write(int puzzleNumber, std::string text) {
+        auto waitStart = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        waitMicros += microsSince(waitStart);
+
+        pending[puzzleNumber] = std::move(text);
+        if (mode == WriterMode::Queued) {
+            ready.notify_one();
+            return;
+        }
+        while (!pending.empty() && pending.begin()->first == nextPuzzle) {
+            writeToFile(pending.begin()->second);
+            pending.erase(pending.begin());
+            ++nextPuzzle;
+        }
+    }
+
+    // Write everything still queued and stop the writer thread
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishing = true;
+        }
+        ready.notify_one();
+        if (writerThread.joinable()) {
+            writerThread.join();
+        }
+    }
+
+    // Total time workers spent waiting to hand over their output
+    double waitSeconds() const { return waitMicros / 1e6; }
+
+private:
+    WriterMode mode;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::ofstream file;
+    std::map<int, std::string> pending; // Finished puzzles waiting for an earlier one
+    int nextPuzzle = 0;
+    bool finishing = false;
+    std::thread writerThread;
+    std::atomic<std::uint64_t> waitMicros{0};
+
+    void writeToFile(const std::string& text) {
+        if (file.is_open()) {
+            file << text;
+            metrics.bytesWritten += text.size();
+        }
+    }
+
+    // Writer thread: take the next puzzle in order and write it outside the lock
+    void writeQueued() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            ready.wait(lock, [this] { return finishing || (!pending.empty() && pending.begin()->first == nextPuzzle); });
+            if (pending.empty() || pending.begin()->first != nextPuzzle) {
+                break; // Finishing and nothing more can be written in order
+            }
+            std::string text = std::move(pending.begin()->second);
+            pending.erase(pending.begin());
+            ++nextPuzzle;
+            lock.unlock();
+            writeToFile(text);
+            lock.lock();
+        }
+    }
+};
+
+// Summary of a finished job
+struct JobStats {
+    int numThreads = 0;
+    int puzzlesGenerated = 0; // Fewer than requested if the job was cancelled
+    int puzzlesDegraded = 0;
+    int puzzlesFailed = 0;
+    double elapsedSeconds = 0;
+    double outputWaitSeconds = 0; // Summed over all workers
+};
+
+// Generate a single puzzle and hand it to the writer, measuring each phase.
+// With a deadline, each attempt gets the job's puzzleDeadline: placement may
+// use the first half, and the fill the rest. Jobs with an archive take each
+// puzzle's words from the archived grid instead of placing them; jobs with
+// variants then fill copies of the placement from seeds of their own, each
+// with a full deadline.
+PuzzleResult generatePuzzle(const PuzzleJob& job, unsigned jobSeed, int puzzleNumber, std::shared_ptr<const BannedWordMatcher> matcher,
+                            std::shared_ptr<const SlotTable> slotTable, std::shared_ptr<const TileLibrary> tiles, PuzzleWriter& writer, const PerfCounters* perfCounters, JobMetrics& jobMetrics) {
+    log(LogLevel::INFO, "Generating puzzle " + std::to_string(puzzleNumber + 1) + "...");
+    PuzzleMeasurements measurements;
+    AllocationCounts puzzleStartAllocations = currentThreadAllocations();
+    auto puzzleStart = std::chrono::steady_clock::now();
+
+    int attempts = job.deadlinePolicy == DeadlinePolicy::Retry ? std::max(1, job.maxAttempts) : 1;
+    std::unique_ptr<WordSearch> ws;
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        if (attempt > 0) {
+            log(LogLevel::WARN, "Puzzle " + std::to_string(puzzleNumber + 1) + " attempt " + std::to_string(attempt) + " did not complete (" +
+                                puzzleResultName(ws->result()) + "); retrying with a new seed.");
+            ++metrics.puzzleRetries;
+        }
+        ws.reset(new WordSearch(job.rows, job.cols, job.words, job.letters, job.bannedWords,
+                                puzzleSeed(jobSeed, puzzleNumber, attempt), matcher, slotTable));
+        ws->setFillMode(job.fillMode, tiles);
+        ws->setFillThreads(job.fillThreads);
+        ws->setLetterTolerance(job.letterTolerance);
+        ws->setShadowGrids(job.shadowGrids);
+        ws->setWrapAround(job.wrapAround); // validateJob() checked the lengths
+        if (job.puzzleDeadline.count() > 0) {
+            auto attemptStart = std::chrono::steady_clock::now();
+            ws->setDeadlines(attemptStart + job.puzzleDeadline / 2, attemptStart + job.puzzleDeadline);
+        }
+        {
+            PhaseScope scope(Phase::Placement, measurements, perfCounters);
+            if (job.archive.empty()) {
+                ws->placeWords();
+            } else {
+                ws->setGrid(job.archive[puzzleNumber]);
+                ws->restorePlacements();
+            }
+        }
+        {
+            PhaseScope scope(Phase::Fill, measurements, perfCounters);
+            ws->fillGrid();
+        }
+        if (ws->result() == PuzzleResult::Complete) {
+            break;
+        }
+    }
+
+    // Render each variant, flagged if it is not complete; the puzzle's
+    // result is the worst of its variants
+    std::ostringstream text;
+    std::vector<PuzzleStats> variantStats;
+    std::vector<PuzzleResult> variantResults;
+    PuzzleResult result = PuzzleResult::Complete;
+    auto render = [&](const WordSearch& puzzle, int variant) {
+        std::string label = "Puzzle " + std::to_string(puzzleNumber + 1);
+        if (job.variants > 1) {
+            label += " variant " + std::to_string(variant + 1);
+        }
+        PuzzleResult variantResult = puzzle.result();
+        const PuzzleStats& stats = puzzle.stats();
+        if (variantResult == PuzzleResult::Degraded) {
+            log(LogLevel::WARN, label + " is degraded: " + std::to_string(stats.wordsSkipped) + " word(s) skipped when placement ran out of time.");
+        } else if (variantResult == PuzzleResult::Failed) {
+            log(LogLevel::WARN, label + " failed: " + std::to_string(stats.unfilledCells) + " cell(s) left empty because " +
+                                (stats.deadlineExceeded ? "the fill ran out of time." : "every letter formed a banned word."));
+        }
+        text << label;
+        if (variantResult != PuzzleResult::Complete) {
+            text << " (" << puzzleResultName(variantResult) << ")";
+        }
+        text << ":\n";
+        puzzle.printGrid(text); // Print the grid to the buffer
+        text << "\n";
+        variantStats.push_back(stats);
+        variantResults.push_back(variantResult);
+        result = std::max(result, variantResult);
+    };
+    render(*ws, 0);
+    for (int variant = 1; variant < job.variants; ++variant) {
+        WordSearch refilled = ws->variant(variantSeed(jobSeed, puzzleNumber, variant));
+        if (job.puzzleDeadline.count() > 0) {
+            auto fillStart = std::chrono::steady_clock::now();
+            refilled.setDeadlines(fillStart, fillStart + job.puzzleDeadline);
+        }
+        {
+            PhaseScope scope(Phase::Fill, measurements, perfCounters);
+            refilled.fillGrid();
+        }
+        render(refilled, variant);
+    }
+
+    // Save the generated grids to the output file
+    {
+        PhaseScope scope(Phase::Write, measurements, perfCounters);
+        writer.write(puzzleNumber, text.str());
+    }
+    measurements.latency.puzzle.record(microsSince(puzzleStart));
+    if (allocationCountingEnabled) {
+        logPuzzleAllocations(puzzleNumber, measurements, currentThreadAllocations() - puzzleStartAllocations);
+    }
+
+    for (std::size_t i = 0; i < variantStats.size(); ++i) {
+        metrics.recordPuzzle(variantStats[i], variantResults[i], i == 0 ? measurements.latency : LatencyReport());
     }
+    jobMetrics.merge(measurements);
+    return result;
+}
+
+// Log latency percentiles for whole puzzles and for each phase
+void logLatencyReport(const LatencyReport& latency) {
+    log(LogLevel::INFO, "Puzzle latency: " + formatPercentiles(latency.puzzle));
+    for (int i = 0; i < phaseCount; ++i) {
+        log(LogLevel::INFO, std::string("  ") + phaseName(static_cast<Phase>(i)) + " latency: " + formatPercentiles(latency.phases[i]));
+    }
+}
+
+// Log the hardware event totals per phase, with instructions per cycle, over
+// the puzzles actually written, each variant counting as one
+void logHardwareCounterReport(const HardwareCounterTotals& hardware, int numPuzzles) {
+    if (hardware.availableMask == 0) {
+        return;
+    }
+    for (int p = 0; p < phaseCount; ++p) {
+        Phase phase = static_cast<Phase>(p);
+        std::string line = std::string(phaseName(phase)) + " counters:";
+        for (int e = 0; e < hardwareEventCount; ++e) {
+            HardwareEvent event = static_cast<HardwareEvent>(e);
+            line += std::string(" ") + hardwareEventName(event) + "=";
+            line += hardware.available(event) ? std::to_string(hardware.value(phase, event)) : "n/a";
+        }
+        if (hardware.available(HardwareEvent::Cycles) && hardware.available(HardwareEvent::Instructions) &&
+            hardware.value(phase, HardwareEvent::Cycles) > 0) {
+            char ipc[32];
+            std::snprintf(ipc, sizeof(ipc), "%.2f", static_cast<double>(hardware.value(phase, HardwareEvent::Instructions)) /
+                                                    hardware.value(phase, HardwareEvent::Cycles));
+            line += std::string(" ipc=") + ipc;
+        }
+        line += " (over " + std::to_string(numPuzzles) + " puzzles)";
+        log(LogLevel::INFO, line);
+    }
+}
+
+// Generate multiple puzzles in parallel on a fixed pool of worker threads
+// that take the next puzzle number until none are left. Cancelling the job
+// lets puzzles already started finish, so the output file always holds
+// the first puzzlesGenerated puzzles of the uncancelled job.
+JobStats generatePuzzles(const PuzzleJob& job) {
+    JobStats stats;
+    std::string error = validateJob(job);
+    if (!error.empty()) {
+        log(LogLevel::ERROR, error);
+        return stats;
+    }
+    stats.numThreads = job.numThreads > 0 ? job.numThreads : std::max(1u, std::thread::hardware_concurrency());
+    stats.numThreads = std::max(1, std::min(stats.numThreads, job.numPuzzles));
+
+    unsigned jobSeed = job.seed;
+    if (jobSeed == 0) {
+        jobSeed = std::random_device{}();
+        log(LogLevel::INFO, "Using seed " + std::to_string(jobSeed) + ".");
+    }
+
+    auto matcher = std::make_shared<const BannedWordMatcher>(job.bannedWords, gridAlphabet(job.letters, job.words)); // Shared by every puzzle
+    auto slotTable = std::make_shared<const SlotTable>(job.rows, job.cols, longestWord(job.words));
+    std::shared_ptr<const TileLibrary> tiles;
+    if (job.fillMode == FillMode::Tiles) {
+        tiles = TileLibrary::load(job.tileCacheDir, job.letters, job.bannedWords, *matcher);
+    }
+    PuzzleWriter writer(job.outputFile, job.writerMode);
+    JobMetrics jobMetrics;
+    std::atomic<int> nextPuzzle(0);
+    std::atomic<int> puzzlesDegraded(0);
+    std::atomic<int> puzzlesFailed(0);
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < stats.numThreads; ++t) {
+        workers.emplace_back([&] {
+            // Counters follow the calling thread, so each worker opens its own
+            std::unique_ptr<PerfCounters> perfCounters;
+            if (perfCountersRequested) {
+                perfCounters.reset(new PerfCounters());
+                if (perfCounters->availableMask() == 0) {
+                    perfCounters.reset();
+                }
+            }
+            while (!(job.cancel && job.cancel->load())) {
+                int i = nextPuzzle++;
+                if (i >= job.numPuzzles) {
+                    break;
+                }
+                PuzzleResult result = generatePuzzle(job, jobSeed, i, matcher, slotTable, tiles, writer, perfCounters.get(), jobMetrics);
+                if (result == PuzzleResult::Degraded) {
+                    ++puzzlesDegraded;
+                } else if (result == PuzzleResult::Failed) {
+                    ++puzzlesFailed;
+                }
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join(); // Wait for all puzzles to finish
+    }
+    writer.finish();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> totalElapsed = endTime - startTime;
+    stats.elapsedSeconds = totalElapsed.count();
+    stats.outputWaitSeconds = writer.waitSeconds();
+    stats.puzzlesGenerated = std::min(nextPuzzle.load(), job.numPuzzles); // Every claimed puzzle was finished
+    stats.puzzlesDegraded = puzzlesDegraded;
+    stats.puzzlesFailed = puzzlesFailed;
+    if (stats.puzzlesDegraded > 0 || stats.puzzlesFailed > 0) {
+        log(LogLevel::WARN, std::to_string(stats.puzzlesDegraded) + " puzzle(s) degraded and " + std::to_string(stats.puzzlesFailed) +
+                            " failed.");
+    }
+    if (stats.puzzlesGenerated < job.numPuzzles) {
+        log(LogLevel::WARN, "Cancelled after " + std::to_string(stats.puzzlesGenerated) + " of " +
+                            std::to_string(job.numPuzzles) + " puzzles.");
+    }
+    log(LogLevel::INFO, "All puzzles generated in " + std::to_string(totalElapsed.count()) + " seconds.");
+    logLatencyReport(jobMetrics.measurements.latency);
+    logHardwareCounterReport(jobMetrics.measurements.hardware, stats.puzzlesGenerated * job.variants);
+    return stats;
+}
+
+// Print the command line options
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--threads N] [--seed N] [--writer locked|queued] [--deadline-ms N] [--deadline-policy degrade|retry] [--fill rejection|repair|tiles|balanced] [--letter-tolerance K] [--shadow-grids] [--wrap-around] [--tile-cache DIR] [--fill-threads N] [--variants N] [--refill ARCHIVE] [--metrics-file PATH] [--metrics-interval SECONDS] [--perf-counters]\n"
+              << "  --threads N                 number of worker threads (default: one per hardware thread)\n"
+              << "  --seed N                    reproduce a previous run's puzzles (default: random, logged at start)\n"
+              << "  --writer locked|queued      write output from the workers under a lock (default) or from a writer thread\n"
+              << "  --deadline-ms N             time limit per puzzle in milliseconds (default: none)\n"
+              << "  --deadline-policy degrade|retry\n"
+              << "                              keep incomplete puzzles, flagged (default), or retry them with a new seed\n"
+              << "  --fill rejection|repair|tiles|balanced\n"
+              << "                              fill cell by cell (default), fill at once and repair banned words,\n"
+              << "                              cover the grid with tiles known to hold no banned word,\n"
+              << "                              or fill cell by cell giving every letter an equal share\n"
+              << "  --letter-tolerance K        cells over an equal share a letter may take with --fill balanced (default 1)\n"
+              << "  --shadow-grids              keep column and diagonal copies of each grid, for faster checks on large grids\n"
+              << "  --wrap-around               let words run off one edge and on at the opposite one\n"
+              << "  --tile-cache DIR            keep tile libraries in DIR for later runs with the same letters and banned words\n"
+              << "  --fill-threads N            fill each grid in blocks on N threads, for very large grids\n"
+              << "  --variants N                write N fills of each puzzle's word placement (default 1)\n"
+              << "  --refill ARCHIVE            keep the words of the puzzles in ARCHIVE, an earlier output file, and refill the rest\n"
+              << "  --metrics-file PATH         write Prometheus text metrics to PATH while running\n"
+              << "  --metrics-interval SECONDS  how often to rewrite the metrics file (default 10)\n"
+              << "  --perf-counters             sample CPU cycles, instructions, cache and branch misses per phase (Linux)\n";
+}
+
+#ifndef WORDSEARCH_NO_MAIN
+std::atomic<bool> interrupted(false);
+
+// Ctrl-C stops the job cleanly: puzzles in progress are finished and written
+extern "C" void handleInterrupt(int) {
+    interrupted = true;
+}
+
+// Main function to get user input and initiate puzzle generation
+int main(int argc, char* argv[]) {
+    PuzzleJob job;
+    std::string metricsFile;
+    int metricsInterval = 10;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            job.numThreads = std::atoi(argv[++i]);
+            if (job.numThreads <= 0) {
+                std::cerr << "Error: --threads must be a positive number.\n";
+                return 1;
+            }
+        } else if (arg == "--seed" && i + 1 < argc) {
+            job.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--writer" && i + 1 < argc) {
+            std::string writer = argv[++i];
+            if (writer == "locked") {
+                job.writerMode = WriterMode::Locked;
+            } else if (writer == "queued") {
+                job.writerMode = WriterMode::Queued;
+            } else {
+                std::cerr << "Error: --writer must be 'locked' or 'queued'.\n";
+                return 1;
+            }
+        } else if (arg == "--deadline-ms" && i + 1 < argc) {
+            int milliseconds = std::atoi(argv[++i]);
+            if (milliseconds <= 0) {
+                std::cerr << "Error: --deadline-ms must be a positive number of milliseconds.\n";
+                return 1;
+            }
+            job.puzzleDeadline = std::chrono::milliseconds(milliseconds);
+        } else if (arg == "--deadline-policy" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "degrade") {
+                job.deadlinePolicy = DeadlinePolicy::Degrade;
+            } else if (policy == "retry") {
+                job.deadlinePolicy = DeadlinePolicy::Retry;
+            } else {
+                std::cerr << "Error: --deadline-policy must be 'degrade' or 'retry'.\n";
+                return 1;
+            }
+        } else if (arg == "--fill" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "rejection") {
+                job.fillMode = FillMode::Rejection;
+            } else if (mode == "repair") {
+                job.fillMode = FillMode::Repair;
+            } else if (mode == "tiles") {
+                job.fillMode = FillMode::Tiles;
+            } else if (mode == "balanced") {
+                job.fillMode = FillMode::Balanced;
+            } else {
+                std::cerr << "Error: --fill must be 'rejection', 'repair', 'tiles' or 'balanced'.\n";
+                return 1;
+            }
+        } else if (arg == "--shadow-grids") {
+            job.shadowGrids = true;
+        } else if (arg == "--wrap-around") {
+            job.wrapAround = true;
+        } else if (arg == "--letter-tolerance" && i + 1 < argc) {
+            job.letterTolerance = std::atoi(argv[++i]);
+            if (job.letterTolerance < 0) {
+                std::cerr << "Error: --letter-tolerance must not be negative.\n";
+                return 1;
+            }
+        } else if (arg == "--fill-threads" && i + 1 < argc) {
+            job.fillThreads = std::atoi(argv[++i]);
+            if (job.fillThreads <= 0) {
+                std::cerr << "Error: --fill-threads must be a positive number.\n";
+                return 1;
+            }
+        } else if (arg == "--variants" && i + 1 < argc) {
+            job.variants = std::atoi(argv[++i]);
+            if (job.variants <= 0) {
+                std::cerr << "Error: --variants must be a positive number.\n";
+                return 1;
+            }
+        } else if (arg == "--refill" && i + 1 < argc) {
+            std::ifstream archive(argv[++i]);
+            std::string error;
+            if (!archive) {
+                std::cerr << "Error: cannot open the archive " << argv[i] << ".\n";
+                return 1;
+            }
+            if (!readArchive(archive, job.archive, error)) {
+                std::cerr << "Error: " << error << "\n";
+                return 1;
+            }
+        } else if (arg == "--tile-cache" && i + 1 < argc) {
+            job.tileCacheDir = argv[++i];
+        } else if (arg == "--metrics-file" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::atoi(argv[++i]);
+            if (metricsInterval <= 0) {
+                std::cerr << "Error: --metrics-interval must be a positive number of seconds.\n";
+                return 1;
+            }
+        } else if (arg == "--perf-counters") {
+            perfCountersRequested = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::cout << "Ultimate Word Search Generator  Copyright (C) 2024  Alexandra Dogwood" << std::endl;
+    std::cout << "This program comes with ABSOLUTELY NO WARRANTY; for details type 'show w'." << std::endl;
+    std::cout << "This is free software, and you are welcome to redistribute it under certain conditions; type 'show c' for details." << std::endl;
+
 
-    std::cout << "Enter banned words (type 'done' when finished): ";
-    while (std::cin >> word && word != "done") {
-        bannedWords.insert(word);
+    std::string error;
+    if (!readJob(std::cin, &std::cout, job, error)) {
+        std::cerr << "Error: " << error << " Exiting.\n";
+        return 1; // Exit if the settings are unusable
     }
 
-    std::cout << "Enter number of puzzles to generate: ";
-    std::cin >> numPuzzles;
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!metricsFile.empty()) {
+        exporter.reset(new MetricsExporter(metricsFile, std::chrono::seconds(metricsInterval)));
+        exporter->start();
+    }
 
-    std::cout << "Enter output file name: ";
-    std::cin >> outputFile;
+    job.cancel = &interrupted;
+    std::signal(SIGINT, handleInterrupt);
+    generatePuzzles(job);
 
-    generatePuzzles(numPuzzles, words, letters, bannedWords, rows, cols, outputFile);
+    if (exporter) {
+        exporter->stop(); // Final write so the file reflects the finished run
+    }
 
     return 0;
 }
+#endif